@@ -19,20 +19,32 @@ Description:
                   |
                 (0,0)
 
-    line equations:
-    line 1 => y = -sqrt3x
-    line 2 => y = sqrt3x
-    line 3 => y = 20
-
-    to find perpendicular of file
-        m1 * m2 = -1
-    and use one point on the line to solve for y = mx + c which is where the ray intersects the side
-
-    logic for finding the equation of reflection of line:
-    reference: https://math.stackexchange.com/questions/67024/the-equation-of-a-line-reflected-about-another-line
-    ax + by = c reflected over dx + ey = f
-    
-    y - h =   (ae^2 - ad^2 - 2bde)(x-k)/(be^2 - bd^2 + 2ade)
+    the ray escapes when it hits a side with y < 0.01 (next to the vertex at 0,0)
+
+    Inputs which are plain decimals are solved without tracing using the unfolded
+    triangular lattice (see UnfoldingSolver.h), other inputs are traced reflection by reflection
+    in the triangle as a polygon mirror cavity (see PolygonCavity.h)
+
+    Usage:
+        ./sim <x>                               -> lab problem, x is between -10 and 10
+        ./sim --cavity <file> <dirX> <dirY>     -> any convex cavity file, ray direction dirX, dirY into the cavity
+        ./sim --sweep <from> <to> <count>       -> one line per ray for count values of x
+        ./sim --cavity <file> --sweep <from> <to> <count>
+                                                -> sweep of the ray direction angle in degrees
+        ./sim --polyhedron <name|file> <dirX> <dirY> <dirZ>
+                                                -> 3D cavity (tetrahedron, prism, cube or a polyhedron file,
+                                                   see PolyhedronCavity.h), ray direction dirX, dirY, dirZ
+        ./sim --polyhedron <name|file> --sweep <from> <to> <count>
+                                                -> count x count rays, angle from the entry normal swept
+                                                   from..to degrees and count angles around the normal,
+                                                   traced on --threads <n> threads (default: all cores)
+        --budget <n> can be added to any of these to limit the reflections traced per ray
+        (a ray on a periodic orbit is reported as such instead of being traced forever)
+        --path <file> streams the bounce points of the traced 2D rays to a binary file (see ReflectionPath.h)
+        --cache <file> keeps the results of 2D sweeps on disk so later sweeps reuse them (see SweepCache.h)
+        ./sim --check <scale>                   -> traces every x = k / 10^scale on AB and compares the
+                                                   reflections with the unfolding solver, writes the
+                                                   inputs they disagree on
 */
 
 
@@ -43,8 +55,17 @@ Description:
 #include <fstream>
 #include <limits>
 #include <string>
+#include <vector>
 #include <cmath>
 #include <iomanip>
+#include <iterator>
+#include <thread>
+
+#include "PolygonCavity.h"
+#include "PolyhedronCavity.h"
+#include "ReflectionPath.h"
+#include "SweepCache.h"
+#include "UnfoldingSolver.h"
 
 /*
 * Function to check whether the input argument is a number,
@@ -79,370 +100,403 @@ bool convertToNumber(const char* charsToCheck, long double& inNumber)
     }
 }
 
+// Reflection budget per ray when none is given with --budget
+const long long defaultReflectionBudget = 1000000000;
+
+// Max digits after the point for --check, 20 * 10^5 + 1 rays
+const int maxCheckScale = 5;
+
 /*
-* Class for cartesian coordinates of point
+* Function to create the triangle of the lab problem as a mirror cavity
+* Vertices C = (0,0), B = (10, 10sqrt3) and A = (-10, 10sqrt3) in counter clockwise order
+* Return cavity with the exits next to C and the entry point at C
 */
-class Coordinate
+PolygonCavity createLabTriangle()
 {
-    // X and Y coordinates
-    long double x;
-    long double y;
-public:
-    /*
-    * Constructor to setup default values
-    */
-    Coordinate() : x(0), y(0) {}
-
-    /*
-    * Constructor to setup using input values
-    * @param xCorr x coordinate
-    * @param yCorr y coordinate
-    */
-    Coordinate(long double const xCorr, long double const yCorr) : x(xCorr), y(yCorr) {}
-
-    /*
-    * Getter to get x coordinate
-    * Return x coordinate of the point
-    */
-    long double getX()
-    {
-        return this->x;
-    }
-
-    /*
-    * Getter to get y coordinate
-    * Return y coordinate of the point
-    */
-    long double getY()
-    {
-        return this->y;
-    }
-
-    /*
-    * Setter for x and y coordinate
-    * @param xCorr x coordinate of the point
-    * @param yCorr y coorindate of the point
-    */
-    void setCoordinate(long double xCorr, long double yCorr)
-    {
-        this->x = xCorr;
-        this->y = yCorr;
-    }
-
-    /*
-    * Function to print the coordinates
-    * Used for debugging
-    */
-    void printCoordinate()
-    {
-        std::cout << std::setprecision(64) << "Point location is x = " << this->x << " y = " << this->y << std::endl;
-    }
-    /*
-    * Function to check if the current point is valid
-    * Validity check: if x is between -10 and 10 or equal to either
-    * and y is between 0 and 20 or equal to either
-    * Return bool
-    */
-    bool isValid()
-    {
-        double xToCheck = double(this->x);
-        double yToCheck = double(this->y);
-        bool checkX = ((xToCheck > -10 && xToCheck < 10) || xToCheck == -10 || xToCheck == 10);
-        bool checkY = ((yToCheck > 0 && yToCheck < 10 * sqrt(3)) || yToCheck == double(10 * sqrt(3)) || yToCheck == 0);
-        return checkX && checkY;
-    }
-
-    /*
-    * Overload operator !=
-    */
-    bool operator!= (Coordinate toCheck)
-    {
-        if ((double)(this->x) != (double)(toCheck.getX()) || (double)(this->y) != (double)(toCheck.getY()))
-        {
-            return true;
-        }
-        return false;
-    }
-
-    /*
-    * Overload operator ==
-    */
-    bool operator== (Coordinate toCheck)
-    {
-        if ((double)(this->x) == (double)(toCheck.getX()) && (double)(this->y) == (double)(toCheck.getY()))
-        {
-            return true;
-        }
-        return false;
-    }
-}; // Coordinate
+    std::vector<Vector2> triangle(3);
+    triangle[0].x = 0;
+    triangle[0].y = 0;
+    triangle[1].x = 10;
+    triangle[1].y = 10 * sqrt(3);
+    triangle[2].x = -10;
+    triangle[2].y = 10 * sqrt(3);
+
+    PolygonCavity cavity(triangle);
+
+    // Ray escapes below y = 0.01 on CB and AC, as a fraction of the side length of 20
+    double escapeFraction = 0.01 / sin(M_PI / 3) / 20;
+    cavity.addExitSegment(0, 0, escapeFraction);
+    cavity.addExitSegment(2, 1 - escapeFraction, 1);
+    cavity.setEntryPoint(triangle[0]);
+    return cavity;
+}
 
+/*
+* Struct to hold the command line options
+*/
+struct ProgramOptions
+{
+    std::string cavityFile;             // cavity file, empty for the lab triangle
+    std::string polyhedron;             // built in polyhedron or polyhedron file, empty for 2D
+    unsigned int threadCount;           // threads for the polyhedron sweep
+    std::string pathFile;               // file to export the bounce points to, empty for none
+    std::string cacheFile;              // file to cache the sweep results in, empty for none
+    long long reflectionBudget;         // max number of reflections traced per ray
+    bool sweep;                         // sweep the entry parameter instead of one ray
+    long double sweepFrom;              // first value of the sweep
+    long double sweepTo;                // last value of the sweep
+    long long sweepCount;               // number of rays in the sweep
+    int checkScale;                     // digits after the point of the checked inputs, -1 for no check
+    std::vector<const char*> values;    // arguments which are not options
+};
 
 /*
-* Class to represent a line
-* y = mx+c
-* m => slope
-* c => constant
+* Function to parse the command line into the options
+*
+* @param argc number of arguments
+* @param argv arguments
+* @param options reference to the options to fill
+* Returns: bool if the options are valid
 */
-class Line
+bool parseOptions(int argc, char* argv[], ProgramOptions& options)
 {
-    // Variable to represent the line
-    long double slope;
-    long double constant;
-public:
-    /*
-    * Constructor to init the class
-    */
-    Line() : slope(0), constant(0) {}
-
-    /*
-    * Constructor to init using input values
-    * @param inSlope slope of the line
-    * @param inConstant constant of the line
-    */
-    Line(long double inSlope, long double inConstant) : slope(inSlope), constant(inConstant) {}
-
-    /*
-    * Setter for the slope and constant of the line
-    * @param inSlope slope of the line
-    * @param inConstant constant of the line
-    */
-    void setLine(long double inSlope, long double inConstant)
-    {
-        this->slope = inSlope;
-        this->constant = inConstant;
-    }
-
-    /*
-    * Getter for the slope
-    * Return slope of the line
-    */
-    long double getSlope()
-    {
-        return this->slope;
-    }
-
-    /*
-    * Getter for the constant
-    * Return constant of the line
-    */
-    long double getConstant()
-    {
-        return this->constant;
-    }
-
-    /*
-    * Function to create line from 2 points (A and B)
-    * @param A point B for the line AB
-    * @param B point B for the line AB
-    */
-    void createLine(Coordinate APoint, Coordinate BPoint)
-    {
-        // Variable to hold the x and y coordinate of A and B
-        long double x1 = APoint.getX();
-        long double x2 = BPoint.getX();
-        long double y1 = APoint.getY();
-        long double y2 = BPoint.getY();
-
-        if (x2 - x1 != 0)
+    options.reflectionBudget = defaultReflectionBudget;
+    options.threadCount = std::max(1u, std::thread::hardware_concurrency());
+    options.sweep = false;
+    options.sweepFrom = 0;
+    options.sweepTo = 0;
+    options.sweepCount = 0;
+    options.checkScale = -1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        long double number{ 0 };
+        if (strcmp(argv[i], "--cavity") == 0 && i + 1 < argc)
+        {
+            options.cavityFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--polyhedron") == 0 && i + 1 < argc)
+        {
+            options.polyhedron = argv[++i];
+        }
+        else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc)
+        {
+            options.pathFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+        {
+            options.cacheFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            if (not convertToNumber(argv[++i], number) || number < 1)
+            {
+                return false;
+            }
+            options.threadCount = (unsigned int)number;
+        }
+        else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+        {
+            if (not convertToNumber(argv[++i], number) || number < 1)
+            {
+                return false;
+            }
+            options.reflectionBudget = (long long)number;
+        }
+        else if (strcmp(argv[i], "--sweep") == 0 && i + 3 < argc)
+        {
+            options.sweep = true;
+            if (not convertToNumber(argv[i + 1], options.sweepFrom) ||
+                not convertToNumber(argv[i + 2], options.sweepTo) ||
+                not convertToNumber(argv[i + 3], number) || number < 1)
+            {
+                return false;
+            }
+            options.sweepCount = (long long)number;
+            i += 3;
+        }
+        else if (strcmp(argv[i], "--check") == 0 && i + 1 < argc)
         {
-            // If the slope is not inf
-            this->slope = (y2 - y1) / (x2 - x1);
+            if (not convertToNumber(argv[++i], number) || number < 0 || number > maxCheckScale)
+            {
+                return false;
+            }
+            options.checkScale = (int)number;
+        }
+        else if (strncmp(argv[i], "--", 2) == 0)
+        {
+            return false;
         }
         else
         {
-            // If the slope is inf then set it the max the variable can hold
-            this->slope = std::numeric_limits<double>::max();
+            options.values.push_back(argv[i]);
         }
-
-        // Now we know slope => put one coordinate in line and solve for constant
-        this->constant = y2 - this->slope * x2;
     }
 
-    /*
-    * Function to create line from the slope and 1 point
-    * @param inSlope slope of the line
-    * @param point the point on the line
-    */
-    void createLine(long double inSlope, Coordinate point)
+    if (not options.cavityFile.empty() && not options.polyhedron.empty())
     {
-        this->slope = inSlope;
-        // Using y = mx+c then c = y - mx
-        this->constant = point.getY() - this->slope * point.getX();
+        return false;
     }
-
-    /*
-    * Function to print the line
-    * Used of debugging
-    */
-    void printLine()
+    // Path export and the cache are for the 2D cavities, the cache only for sweeps
+    if (not options.polyhedron.empty() && (not options.pathFile.empty() || not options.cacheFile.empty()))
     {
-        std::cout << "Equation of line is y = " << this->slope << "x + " << this->constant << std::endl;
+        return false;
     }
-
-    /*
-    * Function to find the x coordinate if the y is given
-    * @param y coordinate of the point on the line
-    * Return x coordinate of the point on the line
-    */
-    long double findXCoordinate(long double y)
+    if (not options.cacheFile.empty() && not options.sweep)
     {
-        // Using y = mx + c => x = (y-c)/m;
-        return (y - this->constant) / this->slope;
+        return false;
     }
-
-    /*
-    * Function to find the y coordinate if the x is given
-    * @param x coordinate of the point on the line
-    * Return y coordinate of the point on the line
-    */
-    long double findYCoordinate(long double x)
+    // The check is for the lab triangle only and traces its own inputs
+    if (options.checkScale >= 0 && (options.sweep || not options.cavityFile.empty() ||
+        not options.polyhedron.empty() || not options.pathFile.empty()))
     {
-        // Using y = mx + c
-        return (this->slope * x + this->constant);
+        return false;
     }
 
-    /*
-    * Overload operator !=
-    */
-    bool operator!= (Line toCheck)
+    // Sweep takes no values, one ray takes x for the triangle, dirX dirY for a cavity
+    // or dirX dirY dirZ for a polyhedron
+    std::size_t valuesNeeded = 1;
+    if (options.sweep || options.checkScale >= 0)
     {
-        if (double(this->slope) != double(toCheck.getSlope()) || double(this->constant) != double(toCheck.getConstant()))
-        {
-            return true;
-        }
-        return false;
+        valuesNeeded = 0;
     }
-};
+    else if (not options.polyhedron.empty())
+    {
+        valuesNeeded = 3;
+    }
+    else if (not options.cavityFile.empty())
+    {
+        valuesNeeded = 2;
+    }
+    return options.values.size() == valuesNeeded;
+}
 
 /*
-* Function to get point of intersection between two lines
-* @param line1 of form y = mx+c
-* @param line2 of form y = mx+c
-* Return point of intersection
+* Function to write how a trace ended
+*
+* @param out stream to write to
+* @param result result of the trace
 */
-Coordinate getIntersectionPoint(Line line1, Line line2)
+void writeTraceResult(std::ostream& out, const TraceResult& result)
 {
-    // Equation of line 1 => y = m1x + c1
-    // Equation of line 2 => y = m2x + c2
-    long double m1 = line1.getSlope();
-    long double m2 = line2.getSlope();
-    long double c1 = line1.getConstant();
-    long double c2 = line2.getConstant();
-
-    // Intersection point found by solving the line equations
-    long double y = (m2 * c1 - m1 * c2) / (m2 - m1);
-    long double x = (c2 - c1) / (m1 - m2);
-
-    // Create the coordinate object for intersection
-    Coordinate intersection(x, y);
-    return intersection;
+    switch (result.status)
+    {
+    case traceEscaped:
+        out << result.reflectionCount;
+        break;
+    case tracePeriodic:
+        out << "Periodic orbit of " << result.period << " reflections, found after "
+            << result.reflectionCount << " reflections";
+        break;
+    case traceBudgetExceeded:
+        out << "Reflection budget exceeded after " << result.reflectionCount << " reflections";
+        break;
+    default:
+        out << "Ray could not be traced";
+        break;
+    }
 }
 
 /*
-* Function to create a perpendicular line
+* Function to create the direction of a 2D ray from its entry parameter
 *
-* @param line1 line to find perpendicular of
-* @param point point of intersection between perpendicular and line
-* Return perpendicular line
+* @param labTriangle if the cavity is the lab triangle
+* @param value x on AB for the lab triangle, else the direction angle in degrees
+* Returns: direction of the ray
 */
-Line getPerpendicularLine(Line line1, Coordinate point)
+Vector2 createSweepDirection(bool labTriangle, long double value)
 {
-    // Init the object of the perpendicular line
-    Line perpendicular;
-
-    // Slope of the perpendicular
-    long double m2;
-
-    // Using m1 x m2 = -1
-    if (line1.getSlope() != 0)
+    Vector2 direction;
+    if (labTriangle)
     {
-        // If slope not 0, then m2 will have a non inf value
-        m2 = (-1) * (1 / line1.getSlope());
+        direction.x = (double)value;
+        direction.y = 10 * sqrt(3);
     }
     else
     {
-        // if m1 = 0 => m2 = infinite meaning it is parallel to y-axis
-        // Set to max value long double can hold
-        m2 = std::numeric_limits<double>::max();
+        direction.x = cos((double)value * M_PI / 180);
+        direction.y = sin((double)value * M_PI / 180);
     }
-
-    // Intersection coordinates
-    long double x = point.getX();
-    long double y = point.getY();
-
-    // Solving equation y = m2x + c using x and y above
-    long double c = y - m2 * x;
-
-    // Set the value in the perpendicular line
-    perpendicular.setLine(m2, c);
-    return perpendicular;
+    return direction;
 }
 
 /*
-* Function to get the equation of reflect line
+* Function to create the text identifying a 2D cavity in the sweep cache
+* The whole cavity file is used, so editing the file starts a new cache
 *
-* Reference: https://math.stackexchange.com/questions/67024/the-equation-of-a-line-reflected-about-another-line
+* @param cavityFile cavity file, empty for the lab triangle
+* Returns: key of the cavity
+*/
+std::string createCavityKey(const std::string& cavityFile)
+{
+    if (cavityFile.empty())
+    {
+        return "lab triangle";
+    }
+    std::ifstream inFile(cavityFile.c_str(), std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+    return "cavity\n" + contents;
+}
+
+/*
+* Function to trace one 2D ray from the entry point, exporting its path if wanted
 *
+* @param cavity cavity to trace the ray in
+* @param direction direction of the ray
+* @param reflectionBudget max number of reflections to trace
+* @param path writer for the bounce points, NULL for none
+* @param parameter entry parameter written with the path
+* Returns: result of the trace
+*/
+TraceResult traceRay(const PolygonCavity& cavity, const Vector2& direction, long long reflectionBudget,
+    PathWriter* path, double parameter)
+{
+    if (path != NULL)
+    {
+        path->beginRay(parameter);
+    }
+    TraceResult result = cavity.trace(cavity.createEntryRay(direction), reflectionBudget, path);
+    if (path != NULL)
+    {
+        path->endRay(result);
+    }
+    return result;
+}
 
-* Derived using trignometric simplification across tan
-* 
-* @param mirror line equation of the mirror
-* @param incident line equation of the incident ray
-* Return line equation of the reflected line
+/*
+* Function to check that the tracer agrees with the unfolding solver on the lab triangle
+* Every x = k / 10^scale on AB is both traced and solved on the lattice, these inputs
+* hit the vertices of the triangle exactly and are the hardest for the tracer
+*
+* @param options command line options
+* @param outfile stream to write the inputs the two disagree on to
+* Returns: 0 if they agree on every input, else 1
 */
-Line getReflectedLine(Line mirror, Line incident)
+int runLatticeCheck(const ProgramOptions& options, std::ofstream& outfile)
 {
-    // Setting the values as per the required equation (reference line in the function desc)
-    /*
-    * Solving equations
-    * * Incident Ax + By = C equating to y = mx+c; A = -m, B = 1; C = c;
-    * Mirror Dx + Ey = F equating to y = mx+c; D = -m, E = 1; F = c;
-    * 
-    * Equation used:
-    * (y - h) = (AE^2 - AD^2 - 2BDE)(x - k) / (BE^2 - BD^2 + 2ADE)
-    * where h = (CD - AF) / (BD - AE)
-    *       k = (CE - BF) / (AE - BD)
-    * Variables names set to match these equations 
-    */
-    long double AVar = (-1) * incident.getSlope();
-    long double BVar = 1;
-    long double CVar = incident.getConstant();
-    long double DVar = (-1) * mirror.getSlope();
-    long double EVar = 1;
-    long double FVar = mirror.getConstant();
-
-    long double kVar = (CVar * EVar - BVar * FVar) / (AVar * EVar - BVar * DVar);
-    long double hVar = (CVar * DVar - AVar * FVar) / (BVar * DVar - AVar * EVar);
-
-    long double slope = (AVar * EVar * EVar - AVar * DVar * DVar - 2 * BVar * DVar * EVar) / 
-        (BVar * EVar * EVar - BVar * DVar * DVar + 2 * AVar * DVar * EVar);
-    long double constant = hVar + slope * (-kVar);
-
-    // Create the reflected line
-    Line reflected(slope, constant);
-    return reflected;
+    PolygonCavity cavity = createLabTriangle();
+    long long denominator = 1;
+    for (int i = 0; i < options.checkScale; ++i)
+    {
+        denominator *= 10;
+    }
+
+    long long mismatches = 0;
+    for (long long numerator = -10 * denominator; numerator <= 10 * denominator; ++numerator)
+    {
+        long long expected = countReflectionsByUnfolding(numerator, options.checkScale);
+        long double value = (long double)numerator / denominator;
+        TraceResult result = traceRay(cavity, createSweepDirection(true, value), options.reflectionBudget, NULL, 0);
+        if (result.status == traceEscaped && result.reflectionCount == expected)
+        {
+            continue;
+        }
+        // A ray stopped by the budget before it could escape is not a disagreement
+        if (result.status == traceBudgetExceeded && expected > options.reflectionBudget)
+        {
+            continue;
+        }
+        ++mismatches;
+        outfile << std::fixed << std::setprecision(options.checkScale) << value << " ";
+        writeTraceResult(outfile, result);
+        outfile << " unfolding " << expected << "\n";
+    }
+    outfile << "Checked " << 20 * denominator + 1 << " inputs, " << mismatches << " mismatches";
+    return mismatches == 0 ? 0 : 1;
 }
 
 /*
-* Function to check if the intersection escapes the triangle
-* 
-* @param intersection: Intersection point to check
-* @param xEscapeEdge1: Upper limit of x for escape
-* @param xEscapeEdge2: Lower limit of x for escape
-* @param yLimit: Upper limit of y for escape
-* Return bool whether the point escapes
+* Function to run the 3D polyhedron cavity, one ray or a sweep of the rays
+*
+* @param options command line options
+* @param outfile stream to write the results to
+* Returns: 0 on success, 1 for invalid inputs
 */
-bool isEscape(Coordinate intersection, long double xEscapeEdge1, long double xEscapeEdge2, long double yLimit)
+int runPolyhedron(const ProgramOptions& options, std::ofstream& outfile)
 {
-    long double x = intersection.getX();
-    long double y = intersection.getY();
+    PolyhedronCavity cavity;
+    if (not cavity.createPreset(options.polyhedron) && not cavity.loadFromFile(options.polyhedron))
+    {
+        // Not a built in polyhedron nor a valid polyhedron file
+        outfile << "Invalid inputs";
+        return 1;
+    }
+
+    if (not options.sweep)
+    {
+        long double dirX{ 0 }, dirY{ 0 }, dirZ{ 0 };
+        if (not convertToNumber(options.values[0], dirX) || not convertToNumber(options.values[1], dirY) ||
+            not convertToNumber(options.values[2], dirZ) || (dirX == 0 && dirY == 0 && dirZ == 0))
+        {
+            outfile << "Invalid inputs";
+            return 1;
+        }
+
+        Vector3 direction = { (double)dirX, (double)dirY, (double)dirZ };
+        TraceResult result = cavity.trace(direction, options.reflectionBudget);
+        if (result.status == traceFailed)
+        {
+            std::cerr << "Ray could not be traced" << std::endl;
+            return 0;
+        }
+        writeTraceResult(outfile, result);
+        return 0;
+    }
 
-    if (x < xEscapeEdge1 && x > xEscapeEdge2 && y < yLimit)
+    // Two unit vectors perpendicular to the inward normal of the entry face
+    Vector3 normal = cavity.getEntryNormal();
+    Vector3 helper = { 1, 0, 0 };
+    if (fabs(normal.x) > 0.9)
     {
-        return true;
+        helper.x = 0;
+        helper.y = 1;
     }
-    return false;
+    Vector3 firstAxis = { normal.y * helper.z - normal.z * helper.y, normal.z * helper.x - normal.x * helper.z,
+        normal.x * helper.y - normal.y * helper.x };
+    double axisLength = sqrt(dotProduct(firstAxis, firstAxis));
+    firstAxis.x /= axisLength;
+    firstAxis.y /= axisLength;
+    firstAxis.z /= axisLength;
+    Vector3 secondAxis = { normal.y * firstAxis.z - normal.z * firstAxis.y,
+        normal.z * firstAxis.x - normal.x * firstAxis.z, normal.x * firstAxis.y - normal.y * firstAxis.x };
+
+    // Polar angle from the normal times angle around the normal
+    std::vector<Vector3> directions;
+    std::vector<long double> polarAngles;
+    std::vector<long double> azimuthAngles;
+    for (long long i = 0; i < options.sweepCount; ++i)
+    {
+        long double polar = options.sweepFrom;
+        if (options.sweepCount > 1)
+        {
+            polar += (options.sweepTo - options.sweepFrom) * i / (options.sweepCount - 1);
+        }
+        for (long long j = 0; j < options.sweepCount; ++j)
+        {
+            long double azimuth = 360.0L * j / options.sweepCount;
+            double polarRadians = (double)polar * M_PI / 180;
+            double azimuthRadians = (double)azimuth * M_PI / 180;
+            double along = cos(polarRadians);
+            double across = sin(polarRadians);
+            Vector3 direction = {
+                along * normal.x + across * (cos(azimuthRadians) * firstAxis.x + sin(azimuthRadians) * secondAxis.x),
+                along * normal.y + across * (cos(azimuthRadians) * firstAxis.y + sin(azimuthRadians) * secondAxis.y),
+                along * normal.z + across * (cos(azimuthRadians) * firstAxis.z + sin(azimuthRadians) * secondAxis.z) };
+            directions.push_back(direction);
+            polarAngles.push_back(polar);
+            azimuthAngles.push_back(azimuth);
+        }
+    }
+
+    std::vector<TraceResult> results = cavity.traceParallel(directions, options.reflectionBudget,
+        options.threadCount);
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        outfile << std::setprecision(17) << polarAngles[i] << " " << azimuthAngles[i] << " ";
+        writeTraceResult(outfile, results[i]);
+        outfile << "\n";
+    }
+    return 0;
 }
 
 /*
@@ -461,144 +515,189 @@ int main(int argc, char* argv[])
         return 1;
     }
 
-    if (argc != 2)
+    ProgramOptions options;
+    if (not parseOptions(argc, argv, options))
     {
-        // Check 1: Expected input args = 1 (+ executable)
+        // Check 1: Expected input args for one of the usages
         // Print error if check 1 fails
         outfile << "Invalid inputs";
         outfile.close();
         return 1;
     }
 
-    // Variable to hold the input number
-    long double inNumber{ 0 };
+    if (not options.polyhedron.empty())
+    {
+        int status = runPolyhedron(options, outfile);
+        outfile.close();
+        return status;
+    }
 
-    if (not convertToNumber(argv[1], inNumber))
+    if (options.checkScale >= 0)
     {
-        // Check 2: if the number if not valid
-        outfile << "Invalid inputs";
+        int status = runLatticeCheck(options, outfile);
         outfile.close();
-        return 1;
+        return status;
     }
 
-    // check for range
-    if (inNumber > 10 || inNumber < -10)
+    // Cavity the ray is traced in
+    PolygonCavity cavity;
+    if (options.cavityFile.empty())
+    {
+        cavity = createLabTriangle();
+    }
+    else if (not cavity.loadFromFile(options.cavityFile))
     {
-        // Check 3: if number provided is outside the length of AB
+        // Check 2: if the cavity file is not a valid convex cavity
         outfile << "Invalid inputs";
         outfile.close();
         return 1;
     }
 
-    // Create the edges of the triangle
-    // Variables A,B,C used to match the lab PDF vertices
-    Coordinate A(-10, 10 * sqrt(3));
-    Coordinate B(10, 10 * sqrt(3));
-    Coordinate C(0, 0);
-
-    // Create equations of the sides of triangle
-    Line side1;
-    side1.createLine(A, B);
-    Line side2;
-    side2.createLine(B, C);
-    Line side3;
-    side3.createLine(C, A);
-
-    // Create equations of lines for corners case
-    // When the line hits the vertex, imagine a mirror there such that it reflects
-    // the ray back along its the angle bisector
-
-    // For line through A
-    Line cornerASide;
-    cornerASide.createLine(sqrt(3), A);
-
-    // For line through B
-    Line cornerBSide;
-    cornerBSide.createLine((-1) * sqrt(3), B);
-
-    // For line through C
-    Line cornerCSide;
-    cornerCSide.createLine(0, C);
-
-    // Find the x coordinates on the line AC and BC for y = 0.01 for escape
-    long double xEscapeEdge1 = side2.findXCoordinate(0.01);
-    long double xEscapeEdge2 = side3.findXCoordinate(0.01);
-
-    // inNumber is the x-coordinate of where the first incident ray meets y=20
-    // Create line
-    Line incidentLine;
-    // Point A = (0,0), Point B = (inNumber, 10sqrt3)
-    Coordinate inA(0, 0);
-    Coordinate inB(inNumber, 10 * sqrt(3));
-    incidentLine.createLine(inA, inB);
-
-    // Variable to hold the number of bounces
-    long double relectionCount = 0;
-
-    // Final intersection after checks
-    Coordinate intersection;
-    // Common variable to exclude the same line from being considered in the next iteration
-    Line side;
-    // Reflected equation for each iteration
-    Line reflected;
-
-    do
-    {
-        relectionCount++;
-        // Get point of intersection with all 3 sides
-        Coordinate intersection1 = getIntersectionPoint(incidentLine, side1);
-        Coordinate intersection2 = getIntersectionPoint(incidentLine, side2);
-        Coordinate intersection3 = getIntersectionPoint(incidentLine, side3);
-
-        // check which instersection if valid and inside the equilateral triangle
-        // it should also not be the intersection point considered in the last iteration
-        // => this new mirror side should be different
-        if (intersection1.isValid() && side1 != side)
+    // Writer for the bounce points, only opened with --path
+    PathWriter pathWriter;
+    PathWriter* path = NULL;
+    if (not options.pathFile.empty())
+    {
+        if (not pathWriter.open(options.pathFile))
         {
-            intersection = intersection1;
-            side = side1;
+            std::cerr << "Unable to open path file: " << options.pathFile << std::endl;
+            outfile.close();
+            return 1;
         }
-        else if (intersection2.isValid() && side2 != side)
+        path = &pathWriter;
+    }
+
+    if (options.sweep)
+    {
+        // Results of earlier sweeps of the same cavity, only opened with --cache
+        SweepCache cache;
+        bool useCache = not options.cacheFile.empty();
+        int resolution = findSweepResolution(options.sweepFrom, options.sweepTo, options.sweepCount);
+        if (useCache && not cache.open(options.cacheFile, createCavityKey(options.cavityFile)))
         {
-            intersection = intersection2;
-            side = side2;
+            // Check 3: the cache file can not be opened, or is not a cache of this cavity
+            outfile << "Invalid inputs";
+            outfile.close();
+            return 1;
         }
-        else if (intersection3.isValid() && side3 != side)
+
+        // Sweep x on AB for the triangle, or the direction angle in degrees for a cavity file
+        // Every ray is bounded by the reflection budget so one bad input can not hang the sweep
+        for (long long i = 0; i < options.sweepCount; ++i)
         {
-            intersection = intersection3;
-            side = side3;
+            long double value = options.sweepFrom;
+            if (options.sweepCount > 1)
+            {
+                value += (options.sweepTo - options.sweepFrom) * i / (options.sweepCount - 1);
+            }
+
+            if (useCache)
+            {
+                // Trace at the resolution of the cache so the stored result is exact for its key
+                value = SweepCache::roundParameter(value, resolution);
+            }
+            outfile << std::setprecision(17) << value << " ";
+            Vector2 direction = createSweepDirection(options.cavityFile.empty(), value);
+            if (not cavity.isEntryDirection(direction))
+            {
+                // Ray of the sweep which does not enter the cavity
+                outfile << "Invalid inputs\n";
+                continue;
+            }
+
+            TraceResult result;
+            // A ray whose path is exported is traced even if it is cached
+            if (not useCache || path != NULL || not cache.lookup(value, resolution, options.reflectionBudget, result))
+            {
+                result = traceRay(cavity, direction, options.reflectionBudget, path, (double)value);
+                if (useCache)
+                {
+                    cache.store(value, resolution, result);
+                }
+            }
+
+            writeTraceResult(outfile, result);
+            outfile << "\n";
         }
-        else
+        cache.close();
+        pathWriter.close();
+        outfile.close();
+        return 0;
+    }
+
+    if (not options.cavityFile.empty())
+    {
+        // Any convex cavity loaded from file with the ray direction as input
+        long double dirX{ 0 }, dirY{ 0 };
+        if (not convertToNumber(options.values[0], dirX) || not convertToNumber(options.values[1], dirY))
         {
-            // If not intersection found print error
+            outfile << "Invalid inputs";
             outfile.close();
-            std::cerr << "No intersection found. Bug in code" << std::endl;
-            return 0;
+            return 1;
         }
 
-        // Get line equation of the reflected line using mirror (side) and incidentLine
-        reflected = getReflectedLine(side, incidentLine);
-
-        // check for the corner case when the intersection is at the vertex of the triangle
-        if (intersection == A)
+        Vector2 direction = { (double)dirX, (double)dirY };
+        if (not cavity.isEntryDirection(direction))
         {
-            reflected = getReflectedLine(cornerASide, incidentLine);
+            // Zero direction or a ray which does not enter the cavity
+            outfile << "Invalid inputs";
+            outfile.close();
+            return 1;
         }
-        else if (intersection == B)
+        TraceResult result = traceRay(cavity, direction, options.reflectionBudget, path, 0);
+        pathWriter.close();
+        if (result.status == traceFailed)
         {
-            reflected = getReflectedLine(cornerBSide, incidentLine);
+            outfile.close();
+            std::cerr << "Ray could not be traced" << std::endl;
+            return 0;
         }
-        // No need to check for corner C as that is where the ray would exit
+        writeTraceResult(outfile, result);
+        outfile.close();
+        return 0;
+    }
 
-        incidentLine = reflected;
-        // Used for debugging the intersection points
-        //intersection.printCoordinate();
-    } while (isEscape(intersection, xEscapeEdge1, xEscapeEdge2, 0.01) == false);
+    // Variable to hold the input number
+    long double inNumber{ 0 };
+
+    if (not convertToNumber(options.values[0], inNumber))
+    {
+        // Check 4: if the number if not valid
+        outfile << "Invalid inputs";
+        outfile.close();
+        return 1;
+    }
 
-    relectionCount--; // Remove the last intersection as a reflection as that was the exit point
+    // check for range
+    if (inNumber > 10 || inNumber < -10)
+    {
+        // Check 5: if number provided is outside the length of AB
+        outfile << "Invalid inputs";
+        outfile.close();
+        return 1;
+    }
 
+    // Inputs which are plain decimals are solved exactly on the unfolded lattice
+    // unless the bounce points are wanted, which needs the ray to be traced
+    long long numerator{ 0 };
+    int scale{ 0 };
+    if (path == NULL && convertToFraction(options.values[0], numerator, scale, 7))
+    {
+        outfile << countReflectionsByUnfolding(numerator, scale);
+        outfile.close();
+        return 0;
+    }
 
-    outfile << relectionCount;
+    TraceResult result = traceRay(cavity, createSweepDirection(true, inNumber), options.reflectionBudget,
+        path, (double)inNumber);
+    pathWriter.close();
+    if (result.status == traceFailed)
+    {
+        outfile.close();
+        std::cerr << "Ray could not be traced" << std::endl;
+        return 0;
+    }
+    writeTraceResult(outfile, result);
     outfile.close();
 
     return 0;
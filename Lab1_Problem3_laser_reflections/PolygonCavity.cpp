@@ -0,0 +1,627 @@
+/*
+* Implementation file for PolygonCavity.cpp
+*/
+
+#include "PolygonCavity.h"
+#include "ReflectionPath.h"
+#include "RobustPredicates.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+// Steps per unit used to quantize the ray state for the periodic orbit check
+const double stateResolution = 1e9;
+
+// Reflection counts at a vertex closer than this to a whole number are taken as whole,
+// i.e. the ray leaves sliding along a mirror instead of bouncing off it once more
+const double wedgeTieTolerance = 1e-9;
+
+/*
+* Struct to hold the quantized state of the ray used to detect periodic orbits
+* Position along the edge and direction are rounded to 1 / stateResolution
+*/
+struct OrbitState
+{
+    int edge;               // edge the ray is on, -1 if on a vertex
+    int vertex;             // vertex the ray is on, -1 if on an edge
+    long long position;     // quantized fraction along the edge
+    long long directionX;   // quantized x component of the unit direction
+    long long directionY;   // quantized y component of the unit direction
+
+    /*
+    * Overload operator ==
+    */
+    bool operator== (const OrbitState& toCheck) const
+    {
+        return this->edge == toCheck.edge && this->vertex == toCheck.vertex &&
+            this->position == toCheck.position &&
+            this->directionX == toCheck.directionX && this->directionY == toCheck.directionY;
+    }
+};
+
+/*
+* Function to quantize the state of the ray for the periodic orbit check
+* @param ray current state of the ray
+* @param fraction fraction along the edge of the ray point
+* @param inverseLength 1 / length of the direction of the ray
+* Return quantized state
+*/
+static OrbitState quantizeState(const RayState& ray, double fraction, double inverseLength)
+{
+    OrbitState state;
+    state.edge = ray.edge;
+    state.vertex = ray.vertex;
+    state.position = ray.vertex >= 0 ? 0 : llround(fraction * stateResolution);
+    state.directionX = llround(ray.direction.x * inverseLength * stateResolution);
+    state.directionY = llround(ray.direction.y * inverseLength * stateResolution);
+    return state;
+}
+
+/*
+* Function to scale a vector to unit length
+* @param in vector to scale
+* Return unit vector along in
+*/
+static Vector2 normalize(const Vector2& in)
+{
+    double length = sqrt(dotProduct(in, in));
+    Vector2 out = { in.x / length, in.y / length };
+    return out;
+}
+
+/*
+* Function to find the angle between two vectors, between 0 and pi
+* @param first first vector
+* @param second second vector
+* Return angle in radians
+*/
+static double angleBetween(const Vector2& first, const Vector2& second)
+{
+    return atan2(fabs(crossProduct(first, second)), dotProduct(first, second));
+}
+
+/*
+* Function to count the reflections of a ray hitting a vertex exactly
+* Unfolding the wedge about its mirrors turns the path into a straight line through the vertex,
+* so the ray arriving at angle beta from the mirror hit first crosses every copy of the mirrors
+* closer than pi - beta, one reflection each, whatever the rounding of the reflected directions
+*
+* @param direction direction of the ray arriving at the vertex
+* @param toMirror vector from the vertex along the mirror hit first
+* @param toOther vector from the vertex along the other mirror
+* Return number of reflections before the ray points back inside, at least 1
+*/
+static long long countVertexReflections(const Vector2& direction, const Vector2& toMirror, const Vector2& toOther)
+{
+    Vector2 backwards = { -direction.x, -direction.y };
+    double wedge = angleBetween(toMirror, toOther);
+    double crossings = (M_PI - angleBetween(toMirror, backwards)) / wedge;
+    double whole = floor(crossings + 0.5);
+    long long count = (long long)(fabs(crossings - whole) <= wedgeTieTolerance * std::max(1.0, whole) ?
+        whole : ceil(crossings));
+    return std::max(1LL, count);
+}
+
+/*
+* Function to reflect a direction about a mirror: d = d - 2 (d.n) n
+* @param direction direction to reflect, updated in place
+* @param normal unit normal of the mirror
+*/
+static void reflectDirection(Vector2& direction, const Vector2& normal)
+{
+    double projection = dotProduct(direction, normal);
+    direction.x -= 2 * projection * normal.x;
+    direction.y -= 2 * projection * normal.y;
+}
+
+/*
+* Constructor to create an empty cavity
+*/
+PolygonCavity::PolygonCavity()
+{
+    this->entryPoint.x = 0;
+    this->entryPoint.y = 0;
+}
+
+/*
+* Constructor to create the cavity from the vertices
+* @param inVertices vertices of the convex polygon in order
+*/
+PolygonCavity::PolygonCavity(const std::vector<Vector2>& inVertices) : vertices(inVertices)
+{
+    this->entryPoint = inVertices.front();
+    this->exitSegments.resize(inVertices.size());
+    computeNormals();
+}
+
+/*
+* Function to compute the edge normals from the vertices
+*/
+void PolygonCavity::computeNormals()
+{
+    int edgeCount = getEdgeCount();
+    this->edgeNormals.resize(edgeCount);
+
+    for (int i = 0; i < edgeCount; ++i)
+    {
+        const Vector2& start = this->vertices[i];
+        const Vector2& end = this->vertices[(i + 1) % edgeCount];
+        // Outward normal of a counter clockwise edge is the edge rotated clockwise
+        Vector2 normal = { end.y - start.y, start.x - end.x };
+        this->edgeNormals[i] = normalize(normal);
+    }
+
+}
+
+/*
+* Function to load the cavity from a file
+* @param fileName name of the cavity file
+* Return bool if the file was a valid convex cavity
+*/
+bool PolygonCavity::loadFromFile(const std::string& fileName)
+{
+    std::ifstream inFile(fileName.c_str());
+    if (not inFile.is_open())
+    {
+        return false;
+    }
+
+    std::vector<Vector2> inVertices;
+    std::vector<std::pair<int, std::pair<double, double> > > inExits;
+    bool entryFound = false;
+    Vector2 inEntry = { 0, 0 };
+
+    std::string line;
+    while (std::getline(inFile, line))
+    {
+        // Strip comments
+        std::size_t commentStart = line.find('#');
+        if (commentStart != std::string::npos)
+        {
+            line.erase(commentStart);
+        }
+
+        std::istringstream lineStream(line);
+        std::string keyword;
+        if (not (lineStream >> keyword))
+        {
+            // Empty line
+            continue;
+        }
+
+        if (keyword == "vertex")
+        {
+            Vector2 vertex;
+            if (not (lineStream >> vertex.x >> vertex.y))
+            {
+                return false;
+            }
+            inVertices.push_back(vertex);
+        }
+        else if (keyword == "exit")
+        {
+            int edge;
+            double from, to;
+            if (not (lineStream >> edge >> from >> to) || from > to)
+            {
+                return false;
+            }
+            inExits.push_back(std::make_pair(edge, std::make_pair(from, to)));
+        }
+        else if (keyword == "entry")
+        {
+            if (not (lineStream >> inEntry.x >> inEntry.y))
+            {
+                return false;
+            }
+            entryFound = true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    int edgeCount = (int)inVertices.size();
+    if (edgeCount < 3 || not entryFound)
+    {
+        return false;
+    }
+
+    // Check the polygon is convex and counter clockwise
+    for (int i = 0; i < edgeCount; ++i)
+    {
+        const Vector2& a = inVertices[i];
+        const Vector2& b = inVertices[(i + 1) % edgeCount];
+        const Vector2& c = inVertices[(i + 2) % edgeCount];
+        Vector2 ab = { b.x - a.x, b.y - a.y };
+        Vector2 bc = { c.x - b.x, c.y - b.y };
+        if (crossProduct(ab, bc) <= 0)
+        {
+            return false;
+        }
+    }
+
+    *this = PolygonCavity(inVertices);
+    for (std::size_t i = 0; i < inExits.size(); ++i)
+    {
+        if (inExits[i].first < 0 || inExits[i].first >= edgeCount)
+        {
+            return false;
+        }
+        addExitSegment(inExits[i].first, inExits[i].second.first, inExits[i].second.second);
+    }
+    setEntryPoint(inEntry);
+    return true;
+}
+
+/*
+* Function to add an exit segment on an edge
+* @param edge index of the edge
+* @param from fraction along the edge where the segment starts
+* @param to fraction along the edge where the segment ends
+*/
+void PolygonCavity::addExitSegment(int edge, double from, double to)
+{
+    this->exitSegments[edge].push_back(std::make_pair(from, to));
+}
+
+/*
+* Function to set the point where the ray enters
+* @param point entry point on the boundary
+*/
+void PolygonCavity::setEntryPoint(const Vector2& point)
+{
+    this->entryPoint = point;
+}
+
+/*
+* Getter for the number of edges
+* Return number of edges
+*/
+int PolygonCavity::getEdgeCount() const
+{
+    return (int)this->vertices.size();
+}
+
+/*
+* Function to check if a direction leaves the entry point into the cavity
+* From an edge it must point strictly inside, from a vertex inside the corner or along its edges
+* @param direction direction of the ray
+* Return bool if the ray enters the cavity
+*/
+bool PolygonCavity::isEntryDirection(const Vector2& direction) const
+{
+    if (direction.x == 0 && direction.y == 0)
+    {
+        return false;
+    }
+    int edgeCount = getEdgeCount();
+    RayState ray = createEntryRay(direction);
+    if (ray.vertex >= 0)
+    {
+        // The next vertex is to the right of the ray or on it and the previous one to the left or on it
+        return vertexSide(ray, (ray.vertex + 1) % edgeCount) <= 0 &&
+            vertexSide(ray, (ray.vertex + edgeCount - 1) % edgeCount) >= 0;
+    }
+    // The inside is to the left of the counter clockwise edge, so the end of the edge is to the right of the ray
+    return vertexSide(ray, (ray.edge + 1) % edgeCount) < 0;
+}
+
+/*
+* Function to create the start state of a ray leaving the entry point
+* @param direction direction of the ray, into the cavity (see isEntryDirection)
+* Return state of the ray at the entry point
+*/
+RayState PolygonCavity::createEntryRay(const Vector2& direction) const
+{
+    RayState ray;
+    ray.point = this->entryPoint;
+    ray.direction = direction;
+    ray.edge = -1;
+    ray.vertex = -1;
+
+    int edgeCount = getEdgeCount();
+    double bestDistance = -1;
+    // Entry point is found once per trace so a linear search is good enough
+    for (int i = 0; i < edgeCount; ++i)
+    {
+        const Vector2& start = this->vertices[i];
+        Vector2 offset = { this->entryPoint.x - start.x, this->entryPoint.y - start.y };
+        double distance = fabs(dotProduct(offset, this->edgeNormals[i]));
+        if (dotProduct(offset, offset) == 0)
+        {
+            ray.vertex = i;
+            ray.edge = -1;
+            return ray;
+        }
+        if (bestDistance < 0 || distance < bestDistance)
+        {
+            bestDistance = distance;
+            ray.edge = i;
+        }
+    }
+    return ray;
+}
+
+/*
+* Function to check if a point on an edge lies in one of its exit segments
+* @param edge index of the edge
+* @param fraction fraction along the edge of the point
+* Return bool if the point is on an exit segment
+*/
+bool PolygonCavity::isExit(int edge, double fraction) const
+{
+    const std::vector<std::pair<double, double> >& segments = this->exitSegments[edge];
+    for (std::size_t i = 0; i < segments.size(); ++i)
+    {
+        if (fraction >= segments[i].first && fraction <= segments[i].second)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+* Function to find on which side of the ray a vertex lies, exact near the vertex
+* @param ray current state of the ray
+* @param vertex index of the vertex
+* Return 1 if the vertex is to the left of the ray, -1 if to the right, 0 if on the ray
+*/
+int PolygonCavity::vertexSide(const RayState& ray, int vertex) const
+{
+    const Vector2& point = this->vertices[vertex];
+    return rayOrientation(ray.point.x, ray.point.y, ray.direction.x, ray.direction.y, point.x, point.y);
+}
+
+/*
+* Function to check if the ray leaves through the edge (vertex - 1, vertex)
+* The edge is crossed when its start is to the right of the ray and its end is not
+* @param ray current state of the ray
+* @param edge index of the edge to check
+* Return bool if the ray leaves through the edge
+*/
+bool PolygonCavity::isExitEdge(const RayState& ray, int edge) const
+{
+    return vertexSide(ray, edge) < 0 && vertexSide(ray, (edge + 1) % getEdgeCount()) >= 0;
+}
+
+/*
+* Function to find the edge the ray hits next
+* Binary search over the vertex chain after the current edge, as the vertices
+* to the right of the ray form one contiguous run in a convex polygon
+* @param ray current state of the ray
+* @param predicted edge to try first, -1 for none
+* Return index of the edge hit next
+*/
+int PolygonCavity::findNextEdge(const RayState& ray, int predicted) const
+{
+    int edgeCount = getEdgeCount();
+
+    if (ray.edge < 0 && ray.vertex < 0)
+    {
+        // Ray is not on the boundary => check every edge
+        for (int i = 0; i < edgeCount; ++i)
+        {
+            if (isExitEdge(ray, i))
+            {
+                return i;
+            }
+        }
+        return 0;
+    }
+
+    // Chain of vertices after the current edge or vertex, offset j is vertex base + j
+    // The edge ending at offset j is crossed for the first j with the vertex not to the right
+    // Offset 1 is skipped as the current edge (or edge from the vertex) can not be hit again
+    int base = ray.edge >= 0 ? ray.edge : ray.vertex;
+    int last = ray.edge >= 0 ? edgeCount : edgeCount - 1;
+
+    // Try the edge hit after the current edge last time first
+    if (predicted >= 0)
+    {
+        int predictedOffset = (predicted - base + 1 + edgeCount) % edgeCount;
+        if (predictedOffset == 0)
+        {
+            predictedOffset = edgeCount;
+        }
+        if (predictedOffset >= 2 && predictedOffset <= last && isExitEdge(ray, predicted))
+        {
+            return predicted;
+        }
+    }
+
+    int low = 2, high = last;
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (vertexSide(ray, (base + middle) % edgeCount) >= 0)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+    return (base + low - 1) % edgeCount;
+}
+
+/*
+* Function to trace the ray till it leaves through an exit segment
+* Stops early when the ray is found on a periodic orbit (Brent's cycle detection
+* on the quantized state) or when the reflection budget is used up
+* @param start state of the ray at the entry point
+* @param reflectionBudget max number of reflections to trace
+* @param path writer to stream the bounce points to, NULL to not export the path
+* Return number of reflections and how the trace ended
+*/
+TraceResult PolygonCavity::trace(const RayState& start, long long reflectionBudget, PathWriter* path) const
+{
+    int edgeCount = getEdgeCount();
+    TraceResult result = { 0, traceFailed, 0 };
+    // The direction is not normalized, so the first leg is exactly the ray given and the exact
+    // predicates find the vertices it really hits, reflections keep its length
+    RayState ray = start;
+    double inverseLength = 1 / sqrt(dotProduct(ray.direction, ray.direction));
+
+    // Edge hit after each edge last time, used to predict the next edge
+    std::vector<int> nextEdgePrediction(edgeCount, -1);
+
+    // Brent's cycle detection: the saved state is compared with every later state
+    // and replaced whenever the number of steps since it was saved reaches a power of 2
+    // Position of the entry point is not known, it only delays the first save by one step
+    OrbitState savedState = quantizeState(ray, 0, inverseLength);
+    long long power = 1;
+    long long stepsSinceSaved = 0;
+    // A match is confirmed by matching again one period later, as the quantized
+    // state could match once without the orbit being periodic
+    long long confirmAt = -1;
+    long long reflectionsAtMatch = 0;
+
+    if (path != NULL)
+    {
+        path->addPoint(ray.point.x, ray.point.y);
+    }
+
+    while (true)
+    {
+        if (result.reflectionCount >= reflectionBudget)
+        {
+            result.status = traceBudgetExceeded;
+            return result;
+        }
+
+        int predicted = ray.edge >= 0 ? nextEdgePrediction[ray.edge] : -1;
+        int edge = findNextEdge(ray, predicted);
+        if (ray.edge >= 0)
+        {
+            nextEdgePrediction[ray.edge] = edge;
+        }
+
+        const Vector2& edgeStart = this->vertices[edge];
+        const Vector2& edgeEnd = this->vertices[(edge + 1) % edgeCount];
+        Vector2 edgeVector = { edgeEnd.x - edgeStart.x, edgeEnd.y - edgeStart.y };
+
+        // Check for the corner case when the ray hits a vertex
+        // Decided with the exact predicate instead of comparing the rounded hit point
+        int vertex = -1;
+        double fraction = 0;
+        if (vertexSide(ray, (edge + 1) % edgeCount) == 0)
+        {
+            vertex = (edge + 1) % edgeCount;
+            fraction = 1;
+        }
+        else if (vertexSide(ray, edge) == 0)
+        {
+            vertex = edge;
+        }
+        else
+        {
+            // Solve point + t * direction = start + fraction * (end - start)
+            Vector2 toPoint = { ray.point.x - edgeStart.x, ray.point.y - edgeStart.y };
+            double denominator = crossProduct(edgeVector, ray.direction);
+            if (denominator == 0)
+            {
+                // Ray parallel to the edge it should hit
+                return result;
+            }
+            // The hit is strictly inside the edge, keep the rounded fraction inside as well
+            fraction = crossProduct(toPoint, ray.direction) / denominator;
+            fraction = std::min(nextafter(1.0, 0.0), std::max(nextafter(0.0, 1.0), fraction));
+        }
+
+        Vector2 hit = { edgeStart.x + fraction * edgeVector.x, edgeStart.y + fraction * edgeVector.y };
+        if (vertex >= 0)
+        {
+            hit = this->vertices[vertex];
+        }
+        if (path != NULL)
+        {
+            path->addPoint(hit.x, hit.y);
+        }
+
+        // Check if the ray escapes, a vertex belongs to both edges meeting at it
+        bool escape;
+        if (vertex >= 0)
+        {
+            escape = isExit(vertex, 0) || isExit((vertex + edgeCount - 1) % edgeCount, 1);
+        }
+        else
+        {
+            escape = isExit(edge, fraction);
+        }
+        if (escape)
+        {
+            result.status = traceEscaped;
+            return result;
+        }
+
+        if (vertex >= 0)
+        {
+            // A vertex hit is treated like a hit right next to the vertex on the edge hit
+            // The ray bounces between the two edges meeting at the vertex till it points back inside
+            // The number of bounces comes from the wedge angle, testing the sign of the rounded
+            // direction against the other edge miscounts rays leaving along that edge
+            int mirror = edge;
+            int other = vertex == edge ? (edge + edgeCount - 1) % edgeCount : (edge + 1) % edgeCount;
+            const Vector2& mirrorEnd = this->vertices[vertex == edge ? (edge + 1) % edgeCount : edge];
+            const Vector2& otherEnd = this->vertices[vertex == edge ? other : (other + 1) % edgeCount];
+            Vector2 toMirror = { mirrorEnd.x - hit.x, mirrorEnd.y - hit.y };
+            Vector2 toOther = { otherEnd.x - hit.x, otherEnd.y - hit.y };
+            long long bounces = countVertexReflections(ray.direction, toMirror, toOther);
+            for (long long i = 0; i < bounces; ++i)
+            {
+                reflectDirection(ray.direction, this->edgeNormals[mirror]);
+                ++result.reflectionCount;
+                std::swap(mirror, other);
+            }
+            ray.edge = -1;
+        }
+        else
+        {
+            // Reflect the direction about the edge hit
+            reflectDirection(ray.direction, this->edgeNormals[edge]);
+            ++result.reflectionCount;
+            ray.edge = edge;
+        }
+        ray.point = hit;
+        ray.vertex = vertex;
+
+        // Check for a periodic orbit
+        OrbitState state = quantizeState(ray, fraction, inverseLength);
+        ++stepsSinceSaved;
+        if (confirmAt >= 0)
+        {
+            if (stepsSinceSaved == confirmAt)
+            {
+                if (state == savedState)
+                {
+                    result.status = tracePeriodic;
+                    result.period = result.reflectionCount - reflectionsAtMatch;
+                    return result;
+                }
+                // Not periodic, start the detection again from here
+                savedState = state;
+                power = 1;
+                stepsSinceSaved = 0;
+                confirmAt = -1;
+            }
+        }
+        else if (state == savedState)
+        {
+            // Candidate period found, check the state repeats after one more period
+            confirmAt = 2 * stepsSinceSaved;
+            reflectionsAtMatch = result.reflectionCount;
+        }
+        else if (stepsSinceSaved == power)
+        {
+            savedState = state;
+            power *= 2;
+            stepsSinceSaved = 0;
+        }
+    }
+}
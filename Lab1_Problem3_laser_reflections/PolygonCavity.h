@@ -0,0 +1,189 @@
+/*
+* Header file for the convex polygon mirror cavity
+*
+* The sides of the polygon are mirrors, except the exit segments
+* which let the ray escape. A ray hitting a vertex is treated like a ray
+* passing right next to it, so it reflects off both sides meeting there
+* (each one counted) till it points back inside, the number of those
+* reflections comes from the angle of the vertex. Vertex hits and the next
+* edge are decided with the exact predicates of RobustPredicates.h so the
+* tracer itself only needs double.
+*
+* Cavity file format (one entry per line, '#' starts a comment):
+*   vertex x y              -> vertices of the convex polygon in order
+*   exit edge from to       -> exit segment on edge (vertex edge to edge + 1)
+*                              from and to are fractions (0..1) along the edge
+*   entry x y               -> point on the boundary where the ray enters
+*/
+
+#ifndef __POLYGONCAVITY__HEADER__
+#define __POLYGONCAVITY__HEADER__
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "TraceResult.h"
+
+class PathWriter;
+
+/*
+* Struct for a 2D point or direction
+*/
+struct Vector2
+{
+    double x;
+    double y;
+};
+
+/*
+* Function to get the dot product of two vectors
+* Return a.b
+*/
+inline double dotProduct(const Vector2& a, const Vector2& b)
+{
+    return a.x * b.x + a.y * b.y;
+}
+
+/*
+* Function to get the z component of the cross product of two vectors
+* Return a x b, > 0 if b is counter clockwise from a
+*/
+inline double crossProduct(const Vector2& a, const Vector2& b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+/*
+* Struct to hold the state of the ray between two reflections
+*/
+struct RayState
+{
+    Vector2 point;      // point where the ray last met the boundary
+    Vector2 direction;  // direction the ray is travelling in
+    int edge;           // edge the point is on, -1 if on a vertex
+    int vertex;         // vertex the point is on, -1 if on an edge
+};
+
+/*
+* Class to represent a convex polygon with mirror sides and exit segments
+*/
+class PolygonCavity
+{
+    // Vertices in counter clockwise order
+    std::vector<Vector2> vertices;
+    // Outward unit normal of each edge (vertex i to vertex i + 1)
+    std::vector<Vector2> edgeNormals;
+    // Exit segments of each edge as fractions along the edge
+    std::vector<std::vector<std::pair<double, double> > > exitSegments;
+    // Point on the boundary where the ray enters
+    Vector2 entryPoint;
+
+    /*
+    * Function to compute the edge normals from the vertices
+    */
+    void computeNormals();
+
+    /*
+    * Function to check if a point on an edge lies in one of its exit segments
+    * @param edge index of the edge
+    * @param fraction fraction along the edge of the point
+    * Return bool if the point is on an exit segment
+    */
+    bool isExit(int edge, double fraction) const;
+
+    /*
+    * Function to find on which side of the ray a vertex lies, exact near the vertex
+    * @param ray current state of the ray
+    * @param vertex index of the vertex
+    * Return 1 if the vertex is to the left of the ray, -1 if to the right, 0 if on the ray
+    */
+    int vertexSide(const RayState& ray, int vertex) const;
+
+    /*
+    * Function to check if the ray leaves through the edge (vertex - 1, vertex)
+    * The edge is crossed when its start is to the right of the ray and its end is not
+    * @param ray current state of the ray
+    * @param edge index of the edge to check
+    * Return bool if the ray leaves through the edge
+    */
+    bool isExitEdge(const RayState& ray, int edge) const;
+
+    /*
+    * Function to find the edge the ray hits next
+    * Binary search over the vertex chain after the current edge, as the vertices
+    * to the right of the ray form one contiguous run in a convex polygon
+    * @param ray current state of the ray
+    * @param predicted edge to try first, -1 for none
+    * Return index of the edge hit next
+    */
+    int findNextEdge(const RayState& ray, int predicted) const;
+
+public:
+    /*
+    * Constructor to create an empty cavity
+    */
+    PolygonCavity();
+
+    /*
+    * Constructor to create the cavity from the vertices
+    * @param inVertices vertices of the convex polygon in order
+    */
+    PolygonCavity(const std::vector<Vector2>& inVertices);
+
+    /*
+    * Function to load the cavity from a file
+    * @param fileName name of the cavity file
+    * Return bool if the file was a valid convex cavity
+    */
+    bool loadFromFile(const std::string& fileName);
+
+    /*
+    * Function to add an exit segment on an edge
+    * @param edge index of the edge
+    * @param from fraction along the edge where the segment starts
+    * @param to fraction along the edge where the segment ends
+    */
+    void addExitSegment(int edge, double from, double to);
+
+    /*
+    * Function to set the point where the ray enters
+    * @param point entry point on the boundary
+    */
+    void setEntryPoint(const Vector2& point);
+
+    /*
+    * Getter for the number of edges
+    * Return number of edges
+    */
+    int getEdgeCount() const;
+
+    /*
+    * Function to check if a direction leaves the entry point into the cavity
+    * From an edge it must point strictly inside, from a vertex inside the corner or along its edges
+    * @param direction direction of the ray
+    * Return bool if the ray enters the cavity
+    */
+    bool isEntryDirection(const Vector2& direction) const;
+
+    /*
+    * Function to create the start state of a ray leaving the entry point
+    * @param direction direction of the ray, into the cavity (see isEntryDirection)
+    * Return state of the ray at the entry point
+    */
+    RayState createEntryRay(const Vector2& direction) const;
+
+    /*
+    * Function to trace the ray till it leaves through an exit segment
+    * Stops early when the ray is found on a periodic orbit (Brent's cycle detection
+    * on the quantized state) or when the reflection budget is used up
+    * @param start state of the ray at the entry point
+    * @param reflectionBudget max number of reflections to trace
+    * @param path writer to stream the bounce points to, NULL to not export the path
+    * Return number of reflections and how the trace ended
+    */
+    TraceResult trace(const RayState& start, long long reflectionBudget, PathWriter* path = NULL) const;
+};
+
+#endif // !__POLYGONCAVITY__HEADER__
@@ -0,0 +1,585 @@
+/*
+* Implementation file for PolyhedronCavity.cpp
+*/
+
+#include "PolyhedronCavity.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+// Number of rays traced side by side by the batched tracer
+const int laneCount = 16;
+// Tolerance of the checks of a loaded cavity, relative to the size of the cavity
+const double planeTolerance = 1e-9;
+
+/*
+* Function to get the cross product of two vectors
+* @param a first vector
+* @param b second vector
+* Return a x b
+*/
+static Vector3 crossProduct(const Vector3& a, const Vector3& b)
+{
+    Vector3 cross = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    return cross;
+}
+
+/*
+* Constructor to create an empty cavity
+*/
+PolyhedronCavity::PolyhedronCavity() : entryFace(-1)
+{
+    this->entryPoint.x = 0;
+    this->entryPoint.y = 0;
+    this->entryPoint.z = 0;
+}
+
+/*
+* Function to create one of the built in cavities
+* tetrahedron (regular, edge 20), prism (lab triangle extruded by 20) or cube (edge 20)
+* The ray enters at the centre of face 0 and escapes when it gets back to face 0
+* @param name name of the cavity
+* Return bool if the name is a built in cavity
+*/
+bool PolyhedronCavity::createPreset(const std::string& name)
+{
+    *this = PolyhedronCavity();
+
+    if (name == "tetrahedron")
+    {
+        // Vertices a * (1,1,1), a * (1,-1,-1), a * (-1,1,-1), a * (-1,-1,1) with edge 20
+        // Face i is opposite vertex i, its outward normal points away from that vertex
+        double scale = 20 / (2 * sqrt(2));
+        double signs[4][3] = { { 1, 1, 1 }, { 1, -1, -1 }, { -1, 1, -1 }, { -1, -1, 1 } };
+        for (int i = 0; i < 4; ++i)
+        {
+            Vector3 normal = { -signs[i][0] / sqrt(3), -signs[i][1] / sqrt(3), -signs[i][2] / sqrt(3) };
+            addFace(normal, scale / sqrt(3), i == 0);
+        }
+        // Centre of face 0 is a third of the way from the centre to the opposite of vertex 0
+        Vector3 entry = { -scale / 3, -scale / 3, -scale / 3 };
+        setEntryPoint(entry);
+        return true;
+    }
+    if (name == "prism")
+    {
+        // Lab triangle C(0,0), B(10,10sqrt3), A(-10,10sqrt3) between z = 0 and z = 20
+        Vector3 bottom = { 0, 0, -1 };
+        Vector3 top = { 0, 0, 1 };
+        Vector3 sideCB = { sqrt(3) / 2, -0.5, 0 };
+        Vector3 sideBA = { 0, 1, 0 };
+        Vector3 sideAC = { -sqrt(3) / 2, -0.5, 0 };
+        addFace(bottom, 0, true);
+        addFace(top, 20, false);
+        addFace(sideCB, 0, false);
+        addFace(sideBA, 10 * sqrt(3), false);
+        addFace(sideAC, 0, false);
+        Vector3 entry = { 0, 20 * sqrt(3) / 3, 0 };
+        setEntryPoint(entry);
+        return true;
+    }
+    if (name == "cube")
+    {
+        // Cube between 0 and 20 on every axis
+        Vector3 normals[6] = { { 0, 0, -1 }, { 0, 0, 1 }, { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 } };
+        double offsets[6] = { 0, 20, 0, 20, 0, 20 };
+        for (int i = 0; i < 6; ++i)
+        {
+            addFace(normals[i], offsets[i], i == 0);
+        }
+        Vector3 entry = { 10, 10, 0 };
+        setEntryPoint(entry);
+        return true;
+    }
+    return false;
+}
+
+/*
+* Function to load the cavity from a file
+* @param fileName name of the polyhedron file
+* Return bool if the file was a valid cavity
+*/
+bool PolyhedronCavity::loadFromFile(const std::string& fileName)
+{
+    std::ifstream inFile(fileName.c_str());
+    if (not inFile.is_open())
+    {
+        return false;
+    }
+
+    *this = PolyhedronCavity();
+    std::vector<int> inExits;
+    bool entryFound = false;
+    Vector3 inEntry = { 0, 0, 0 };
+
+    std::string line;
+    while (std::getline(inFile, line))
+    {
+        // Strip comments
+        std::size_t commentStart = line.find('#');
+        if (commentStart != std::string::npos)
+        {
+            line.erase(commentStart);
+        }
+
+        std::istringstream lineStream(line);
+        std::string keyword;
+        if (not (lineStream >> keyword))
+        {
+            // Empty line
+            continue;
+        }
+
+        if (keyword == "plane")
+        {
+            Vector3 normal;
+            double planeOffset;
+            if (not (lineStream >> normal.x >> normal.y >> normal.z >> planeOffset) ||
+                dotProduct(normal, normal) == 0)
+            {
+                return false;
+            }
+            addFace(normal, planeOffset, false);
+        }
+        else if (keyword == "exit")
+        {
+            int face;
+            if (not (lineStream >> face))
+            {
+                return false;
+            }
+            inExits.push_back(face);
+        }
+        else if (keyword == "entry")
+        {
+            if (not (lineStream >> inEntry.x >> inEntry.y >> inEntry.z))
+            {
+                return false;
+            }
+            entryFound = true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    // A bounded polyhedron needs at least 4 faces, the entry point must be on one of them
+    if (this->offset.size() < 4 || not entryFound || not isBounded() || not isOnBoundary(inEntry))
+    {
+        return false;
+    }
+    for (std::size_t i = 0; i < inExits.size(); ++i)
+    {
+        if (inExits[i] < 0 || inExits[i] >= (int)this->offset.size())
+        {
+            return false;
+        }
+        this->exitFace[inExits[i]] = true;
+    }
+    setEntryPoint(inEntry);
+    return true;
+}
+
+/*
+* Function to add a face plane
+* @param normal outward normal of the face, scaled to unit length
+* @param planeOffset offset of the plane along the unit normal
+* @param isExit if the ray escapes through the face
+*/
+void PolyhedronCavity::addFace(const Vector3& normal, double planeOffset, bool isExit)
+{
+    double length = sqrt(dotProduct(normal, normal));
+    this->normalX.push_back(normal.x / length);
+    this->normalY.push_back(normal.y / length);
+    this->normalZ.push_back(normal.z / length);
+    this->offset.push_back(planeOffset / length);
+    this->exitFace.push_back(isExit);
+}
+
+/*
+* Function to set the point where the ray enters
+* @param point entry point on a face
+*/
+void PolyhedronCavity::setEntryPoint(const Vector3& point)
+{
+    this->entryPoint = point;
+    findEntryFace();
+}
+
+/*
+* Function to find the face the entry point is on
+*/
+void PolyhedronCavity::findEntryFace()
+{
+    double bestDistance = std::numeric_limits<double>::max();
+    for (std::size_t i = 0; i < this->offset.size(); ++i)
+    {
+        Vector3 normal = { this->normalX[i], this->normalY[i], this->normalZ[i] };
+        double distance = fabs(dotProduct(normal, this->entryPoint) - this->offset[i]);
+        if (distance < bestDistance)
+        {
+            bestDistance = distance;
+            this->entryFace = (int)i;
+        }
+    }
+}
+
+/*
+* Function to check if the face planes bound the cavity in every direction
+* The cavity is unbounded if some direction v has n.v <= 0 for every normal n. If the normals
+* span 3D space such directions form a pointed cone, and an edge of that cone lies on two
+* of the planes n.v = 0, so only the directions +-(ni x nj) need to be tried
+* Return bool if the outward normals positively span 3D space
+*/
+bool PolyhedronCavity::isBounded() const
+{
+    int faceCount = (int)this->offset.size();
+    std::vector<Vector3> normals(faceCount);
+    for (int i = 0; i < faceCount; ++i)
+    {
+        Vector3 normal = { this->normalX[i], this->normalY[i], this->normalZ[i] };
+        normals[i] = normal;
+    }
+
+    // Normals in one plane leave the directions along its normal free
+    bool spansSpace = false;
+    for (int i = 0; i < faceCount && not spansSpace; ++i)
+    {
+        for (int j = i + 1; j < faceCount && not spansSpace; ++j)
+        {
+            Vector3 cross = crossProduct(normals[i], normals[j]);
+            for (int k = j + 1; k < faceCount && not spansSpace; ++k)
+            {
+                spansSpace = fabs(dotProduct(cross, normals[k])) > planeTolerance;
+            }
+        }
+    }
+    if (not spansSpace)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < faceCount; ++i)
+    {
+        for (int j = i + 1; j < faceCount; ++j)
+        {
+            Vector3 cross = crossProduct(normals[i], normals[j]);
+            double length = sqrt(dotProduct(cross, cross));
+            if (length <= planeTolerance)
+            {
+                // Parallel planes, no edge of the cone along them
+                continue;
+            }
+            // Largest n.v over the faces for v and -v, a direction with none above 0 is unbounded
+            double largestAlong = -std::numeric_limits<double>::infinity();
+            double largestAgainst = -std::numeric_limits<double>::infinity();
+            for (int k = 0; k < faceCount; ++k)
+            {
+                double along = dotProduct(normals[k], cross) / length;
+                largestAlong = std::max(largestAlong, along);
+                largestAgainst = std::max(largestAgainst, -along);
+            }
+            if (largestAlong <= planeTolerance || largestAgainst <= planeTolerance)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+* Function to check if a point is on the boundary of the cavity
+* @param point point to check
+* Return bool if the point is inside every face plane and on at least one, within planeTolerance
+*/
+bool PolyhedronCavity::isOnBoundary(const Vector3& point) const
+{
+    // Tolerance scaled by the size of the cavity and of the point
+    double size = std::max(1.0, sqrt(dotProduct(point, point)));
+    for (std::size_t i = 0; i < this->offset.size(); ++i)
+    {
+        size = std::max(size, fabs(this->offset[i]));
+    }
+
+    bool onFace = false;
+    for (std::size_t i = 0; i < this->offset.size(); ++i)
+    {
+        Vector3 normal = { this->normalX[i], this->normalY[i], this->normalZ[i] };
+        double distance = dotProduct(normal, point) - this->offset[i];
+        if (distance > planeTolerance * size)
+        {
+            // Outside the plane of the face
+            return false;
+        }
+        onFace = onFace || distance >= -planeTolerance * size;
+    }
+    return onFace;
+}
+
+/*
+* Getter for the inward unit normal of the entry face
+* Return inward normal at the entry point
+*/
+Vector3 PolyhedronCavity::getEntryNormal() const
+{
+    Vector3 inward = { -this->normalX[this->entryFace], -this->normalY[this->entryFace],
+        -this->normalZ[this->entryFace] };
+    return inward;
+}
+
+/*
+* Function to trace one ray from the entry point till it leaves through an exit face
+* @param direction direction of the ray
+* @param reflectionBudget max number of reflections to trace
+* Return number of reflections and how the trace ended
+*/
+TraceResult PolyhedronCavity::trace(const Vector3& direction, long long reflectionBudget) const
+{
+    TraceResult result = { 0, traceFailed, 0 };
+    int faceCount = (int)this->offset.size();
+    Vector3 point = this->entryPoint;
+    Vector3 ray = direction;
+    int face = this->entryFace;
+
+    while (true)
+    {
+        if (result.reflectionCount >= reflectionBudget)
+        {
+            result.status = traceBudgetExceeded;
+            return result;
+        }
+
+        // Next face is the closest plane the ray is moving towards
+        double bestDistance = std::numeric_limits<double>::infinity();
+        int bestFace = -1;
+        for (int i = 0; i < faceCount; ++i)
+        {
+            double denominator = this->normalX[i] * ray.x + this->normalY[i] * ray.y + this->normalZ[i] * ray.z;
+            double numerator = this->offset[i] -
+                (this->normalX[i] * point.x + this->normalY[i] * point.y + this->normalZ[i] * point.z);
+            double distance = numerator / denominator;
+            if (denominator > 0 && i != face && distance < bestDistance)
+            {
+                bestDistance = distance;
+                bestFace = i;
+            }
+        }
+        if (bestFace < 0)
+        {
+            return result;
+        }
+
+        point.x += bestDistance * ray.x;
+        point.y += bestDistance * ray.y;
+        point.z += bestDistance * ray.z;
+        if (this->exitFace[bestFace])
+        {
+            result.status = traceEscaped;
+            return result;
+        }
+
+        // Reflect the direction about the face: d = d - 2 (d.n) n
+        double projection = this->normalX[bestFace] * ray.x + this->normalY[bestFace] * ray.y +
+            this->normalZ[bestFace] * ray.z;
+        ray.x -= 2 * projection * this->normalX[bestFace];
+        ray.y -= 2 * projection * this->normalY[bestFace];
+        ray.z -= 2 * projection * this->normalZ[bestFace];
+        face = bestFace;
+        ++result.reflectionCount;
+    }
+}
+
+/*
+* Function to trace many rays from the entry point
+* Rays are kept in structure of arrays lanes so every step runs the same
+* loop over all lanes (vectorized by the compiler), and a lane is given
+* the next ray as soon as its ray is done
+* @param directions directions of the rays
+* @param first index of the first ray to trace
+* @param last index after the last ray to trace
+* @param reflectionBudget max number of reflections to trace per ray
+* @param results results of the rays, written at the index of each ray
+*/
+void PolyhedronCavity::traceBatch(const std::vector<Vector3>& directions, std::size_t first, std::size_t last,
+    long long reflectionBudget, std::vector<TraceResult>& results) const
+{
+    int faceCount = (int)this->offset.size();
+
+    // State of the ray in each lane
+    double pointX[laneCount], pointY[laneCount], pointZ[laneCount];
+    double rayX[laneCount], rayY[laneCount], rayZ[laneCount];
+    int face[laneCount];
+    long long reflectionCount[laneCount];
+    // Index of the ray in each lane, -1 once there are no rays left for the lane
+    long long rayIndex[laneCount];
+
+    double bestDistance[laneCount];
+    int bestFace[laneCount];
+
+    std::size_t nextRay = first;
+    int activeLanes = 0;
+
+    // Function to give a lane the next ray
+    auto loadLane = [&](int lane)
+    {
+        if (nextRay < last)
+        {
+            pointX[lane] = this->entryPoint.x;
+            pointY[lane] = this->entryPoint.y;
+            pointZ[lane] = this->entryPoint.z;
+            rayX[lane] = directions[nextRay].x;
+            rayY[lane] = directions[nextRay].y;
+            rayZ[lane] = directions[nextRay].z;
+            face[lane] = this->entryFace;
+            reflectionCount[lane] = 0;
+            rayIndex[lane] = (long long)nextRay++;
+            ++activeLanes;
+        }
+        else
+        {
+            // Keep the lane numbers finite, the results of the lane are ignored
+            // The idle lane traces the entry normal from the entry point, a ray which always
+            // has a face ahead, so no infinity or NaN of a stale or never set lane slows the loop
+            Vector3 normal = this->getEntryNormal();
+            pointX[lane] = this->entryPoint.x;
+            pointY[lane] = this->entryPoint.y;
+            pointZ[lane] = this->entryPoint.z;
+            rayX[lane] = normal.x;
+            rayY[lane] = normal.y;
+            rayZ[lane] = normal.z;
+            reflectionCount[lane] = 0;
+            rayIndex[lane] = -1;
+            face[lane] = this->entryFace;
+        }
+    };
+
+    // Function to write the result of a lane and give it the next ray
+    auto finishLane = [&](int lane, traceStatus status)
+    {
+        TraceResult result = { reflectionCount[lane], status, 0 };
+        results[rayIndex[lane]] = result;
+        --activeLanes;
+        loadLane(lane);
+    };
+
+    for (int lane = 0; lane < laneCount; ++lane)
+    {
+        loadLane(lane);
+    }
+
+    while (activeLanes > 0)
+    {
+        for (int lane = 0; lane < laneCount; ++lane)
+        {
+            while (rayIndex[lane] >= 0 && reflectionCount[lane] >= reflectionBudget)
+            {
+                finishLane(lane, traceBudgetExceeded);
+            }
+        }
+
+        // Closest plane ahead of each lane, same arithmetic as the single ray tracer
+        for (int lane = 0; lane < laneCount; ++lane)
+        {
+            bestDistance[lane] = std::numeric_limits<double>::infinity();
+            bestFace[lane] = -1;
+        }
+        for (int i = 0; i < faceCount; ++i)
+        {
+            double faceNormalX = this->normalX[i];
+            double faceNormalY = this->normalY[i];
+            double faceNormalZ = this->normalZ[i];
+            double faceOffset = this->offset[i];
+            // Branch free loop over the lanes
+            for (int lane = 0; lane < laneCount; ++lane)
+            {
+                double denominator = faceNormalX * rayX[lane] + faceNormalY * rayY[lane] + faceNormalZ * rayZ[lane];
+                double numerator = faceOffset -
+                    (faceNormalX * pointX[lane] + faceNormalY * pointY[lane] + faceNormalZ * pointZ[lane]);
+                double distance = numerator / denominator;
+                bool closer = denominator > 0 && i != face[lane] && distance < bestDistance[lane];
+                bestDistance[lane] = closer ? distance : bestDistance[lane];
+                bestFace[lane] = closer ? i : bestFace[lane];
+            }
+        }
+
+        for (int lane = 0; lane < laneCount; ++lane)
+        {
+            if (rayIndex[lane] < 0)
+            {
+                continue;
+            }
+            int hitFace = bestFace[lane];
+            if (hitFace < 0)
+            {
+                finishLane(lane, traceFailed);
+                continue;
+            }
+
+            pointX[lane] += bestDistance[lane] * rayX[lane];
+            pointY[lane] += bestDistance[lane] * rayY[lane];
+            pointZ[lane] += bestDistance[lane] * rayZ[lane];
+            if (this->exitFace[hitFace])
+            {
+                finishLane(lane, traceEscaped);
+                continue;
+            }
+
+            double projection = this->normalX[hitFace] * rayX[lane] + this->normalY[hitFace] * rayY[lane] +
+                this->normalZ[hitFace] * rayZ[lane];
+            rayX[lane] -= 2 * projection * this->normalX[hitFace];
+            rayY[lane] -= 2 * projection * this->normalY[hitFace];
+            rayZ[lane] -= 2 * projection * this->normalZ[hitFace];
+            face[lane] = hitFace;
+            ++reflectionCount[lane];
+        }
+    }
+}
+
+/*
+* Function to trace many rays from the entry point on several threads
+* Each thread runs the batched tracer on its own block of the rays
+* @param directions directions of the rays
+* @param reflectionBudget max number of reflections to trace per ray
+* @param threadCount number of threads to use
+* Return results of the rays in the same order as the directions
+*/
+std::vector<TraceResult> PolyhedronCavity::traceParallel(const std::vector<Vector3>& directions,
+    long long reflectionBudget, unsigned int threadCount) const
+{
+    std::vector<TraceResult> results(directions.size());
+    if (threadCount == 0)
+    {
+        threadCount = 1;
+    }
+
+    // Rays per thread, rounded up so every ray is given to a thread
+    std::size_t raysPerThread = (directions.size() + threadCount - 1) / threadCount;
+
+    std::vector<std::thread> threadVector;
+    threadVector.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i)
+    {
+        std::size_t first = i * raysPerThread;
+        std::size_t last = std::min(directions.size(), first + raysPerThread);
+        if (first >= last)
+        {
+            break;
+        }
+        threadVector.push_back(std::thread(&PolyhedronCavity::traceBatch, this, std::cref(directions),
+            first, last, reflectionBudget, std::ref(results)));
+    }
+
+    // Join the threads to the main thread
+    for (std::size_t i = 0; i < threadVector.size(); ++i)
+    {
+        threadVector[i].join();
+    }
+    return results;
+}
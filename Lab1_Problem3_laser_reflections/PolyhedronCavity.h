@@ -0,0 +1,156 @@
+/*
+* Header file for the convex polyhedron mirror cavity
+*
+* 3D version of the polygon cavity: the faces of a convex polyhedron are
+* mirrors, except the exit faces which let the ray escape. The polyhedron is
+* stored as its face planes (outward unit normal n and offset d, inside is
+* n.x <= d) so the next face hit is the plane ahead of the ray with the
+* smallest distance.
+*
+* Polyhedron file format (one entry per line, '#' starts a comment):
+*   plane nx ny nz d        -> face plane, normal pointing out of the polyhedron
+*   exit face               -> face the ray escapes through
+*   entry x y z             -> point on a face where the ray enters
+* A file is rejected if its planes do not bound a region in every direction
+* or if the entry point is not on a face of the polyhedron.
+*/
+
+#ifndef __POLYHEDRONCAVITY__HEADER__
+#define __POLYHEDRONCAVITY__HEADER__
+
+#include <string>
+#include <vector>
+
+#include "TraceResult.h"
+
+/*
+* Struct for a 3D point or direction
+*/
+struct Vector3
+{
+    double x;
+    double y;
+    double z;
+};
+
+/*
+* Function to get the dot product of two vectors
+* Return a.b
+*/
+inline double dotProduct(const Vector3& a, const Vector3& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+/*
+* Class to represent a convex polyhedron with mirror faces and exit faces
+*/
+class PolyhedronCavity
+{
+    // Outward unit normal and offset of each face plane, kept as separate
+    // arrays so the batched tracer can stream them
+    std::vector<double> normalX;
+    std::vector<double> normalY;
+    std::vector<double> normalZ;
+    std::vector<double> offset;
+    // Flag for each face if the ray escapes through it
+    std::vector<char> exitFace;
+    // Point on a face where the ray enters and the face it is on
+    Vector3 entryPoint;
+    int entryFace;
+
+    /*
+    * Function to find the face the entry point is on
+    */
+    void findEntryFace();
+
+    /*
+    * Function to check if the face planes bound the cavity in every direction
+    * Return bool if the outward normals positively span 3D space
+    */
+    bool isBounded() const;
+
+    /*
+    * Function to check if a point is on the boundary of the cavity
+    * @param point point to check
+    * Return bool if the point is inside every face plane and on at least one, within planeTolerance
+    */
+    bool isOnBoundary(const Vector3& point) const;
+
+public:
+    /*
+    * Constructor to create an empty cavity
+    */
+    PolyhedronCavity();
+
+    /*
+    * Function to create one of the built in cavities
+    * tetrahedron (regular, edge 20), prism (lab triangle extruded by 20) or cube (edge 20)
+    * The ray enters at the centre of face 0 and escapes when it gets back to face 0
+    * @param name name of the cavity
+    * Return bool if the name is a built in cavity
+    */
+    bool createPreset(const std::string& name);
+
+    /*
+    * Function to load the cavity from a file
+    * @param fileName name of the polyhedron file
+    * Return bool if the file was a valid cavity
+    */
+    bool loadFromFile(const std::string& fileName);
+
+    /*
+    * Function to add a face plane
+    * @param normal outward normal of the face, scaled to unit length
+    * @param planeOffset offset of the plane along the unit normal
+    * @param isExit if the ray escapes through the face
+    */
+    void addFace(const Vector3& normal, double planeOffset, bool isExit);
+
+    /*
+    * Function to set the point where the ray enters
+    * @param point entry point on a face
+    */
+    void setEntryPoint(const Vector3& point);
+
+    /*
+    * Getter for the inward unit normal of the entry face
+    * Return inward normal at the entry point
+    */
+    Vector3 getEntryNormal() const;
+
+    /*
+    * Function to trace one ray from the entry point till it leaves through an exit face
+    * @param direction direction of the ray
+    * @param reflectionBudget max number of reflections to trace
+    * Return number of reflections and how the trace ended
+    */
+    TraceResult trace(const Vector3& direction, long long reflectionBudget) const;
+
+    /*
+    * Function to trace many rays from the entry point
+    * Rays are kept in structure of arrays lanes so every step runs the same
+    * loop over all lanes (vectorized by the compiler), and a lane is given
+    * the next ray as soon as its ray is done
+    * @param directions directions of the rays
+    * @param first index of the first ray to trace
+    * @param last index after the last ray to trace
+    * @param reflectionBudget max number of reflections to trace per ray
+    * @param results results of the rays, written at the index of each ray
+    */
+    void traceBatch(const std::vector<Vector3>& directions, std::size_t first, std::size_t last,
+        long long reflectionBudget, std::vector<TraceResult>& results) const;
+
+    /*
+    * Function to trace many rays from the entry point on several threads
+    * Each thread runs the batched tracer on its own block of the rays
+    * @param directions directions of the rays
+    * @param reflectionBudget max number of reflections to trace per ray
+    * @param threadCount number of threads to use
+    * Return results of the rays in the same order as the directions
+    */
+    std::vector<TraceResult> traceParallel(const std::vector<Vector3>& directions,
+        long long reflectionBudget, unsigned int threadCount) const;
+};
+
+#endif // !__POLYHEDRONCAVITY__HEADER__
@@ -0,0 +1,86 @@
+/*
+* Implementation file for ReflectionPath.cpp
+*/
+
+#include "ReflectionPath.h"
+
+// Version of the path file format
+const std::uint32_t pathVersion = 1;
+
+/*
+* Function to write the bytes of a value to a stream
+* @param out stream to write to
+* @param value value to write
+*/
+template <typename T>
+static void writeValue(std::ostream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/*
+* Function to create the path file and write the file header
+* @param fileName name of the path file
+* Return bool if the file could be created
+*/
+bool PathWriter::open(const std::string& fileName)
+{
+    this->outFile.open(fileName.c_str(), std::ios::binary | std::ios::trunc);
+    if (not this->outFile.is_open())
+    {
+        return false;
+    }
+    this->outFile.write("RPTH", 4);
+    writeValue(this->outFile, pathVersion);
+    return true;
+}
+
+/*
+* Function to start the path of a new ray
+* Status, count and point count are filled in by endRay
+* @param parameter entry parameter of the ray
+*/
+void PathWriter::beginRay(double parameter)
+{
+    this->rayHeader = this->outFile.tellp();
+    this->pointCount = 0;
+    writeValue(this->outFile, parameter);
+    writeValue(this->outFile, (std::int32_t)traceFailed);
+    writeValue(this->outFile, (std::int64_t)0);
+    writeValue(this->outFile, this->pointCount);
+}
+
+/*
+* Function to add a bounce point to the current ray
+* Stored as float, plenty for plotting a cavity of this size
+* @param x x coordinate of the point
+* @param y y coordinate of the point
+*/
+void PathWriter::addPoint(double x, double y)
+{
+    float point[2] = { (float)x, (float)y };
+    this->outFile.write(reinterpret_cast<const char*>(point), sizeof(point));
+    ++this->pointCount;
+}
+
+/*
+* Function to finish the current ray by writing its result and point count
+* @param result result of the trace
+*/
+void PathWriter::endRay(const TraceResult& result)
+{
+    std::streampos rayEnd = this->outFile.tellp();
+    this->outFile.seekp(this->rayHeader + (std::streamoff)sizeof(double));
+    writeValue(this->outFile, (std::int32_t)result.status);
+    writeValue(this->outFile, (std::int64_t)result.reflectionCount);
+    writeValue(this->outFile, this->pointCount);
+    this->outFile.seekp(rayEnd);
+}
+
+/*
+* Function to close the path file
+*/
+void PathWriter::close()
+{
+    this->outFile.close();
+}
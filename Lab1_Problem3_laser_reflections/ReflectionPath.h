@@ -0,0 +1,73 @@
+/*
+* Header file for the reflection path export
+*
+* Streams the bounce points of traced rays into a compact binary file.
+* Points are written as they are found, the ray header is patched with
+* the point count and result once the ray is done, so a ray with millions
+* of reflections never has to be held in memory.
+*
+* Path file format (little endian, as written by the machine):
+*   char[4] "RPTH", uint32 version (1)
+*   then for each ray:
+*     double parameter          -> entry parameter of the ray (x or angle of the sweep)
+*     int32 status              -> traceStatus of the ray
+*     int64 reflectionCount     -> reflections of the ray
+*     uint64 pointCount         -> number of points following
+*     pointCount x float32[2]   -> entry point, every bounce point, exit point
+* A vertex hit is one bounce point even when it reflects off both edges.
+*/
+
+#ifndef __REFLECTIONPATH__HEADER__
+#define __REFLECTIONPATH__HEADER__
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "TraceResult.h"
+
+/*
+* Class to write the bounce points of rays to a path file
+*/
+class PathWriter
+{
+    std::ofstream outFile;
+    // Position in the file of the header of the current ray
+    std::streampos rayHeader;
+    // Points written for the current ray
+    std::uint64_t pointCount;
+
+public:
+    /*
+    * Function to create the path file and write the file header
+    * @param fileName name of the path file
+    * Return bool if the file could be created
+    */
+    bool open(const std::string& fileName);
+
+    /*
+    * Function to start the path of a new ray
+    * @param parameter entry parameter of the ray
+    */
+    void beginRay(double parameter);
+
+    /*
+    * Function to add a bounce point to the current ray
+    * @param x x coordinate of the point
+    * @param y y coordinate of the point
+    */
+    void addPoint(double x, double y);
+
+    /*
+    * Function to finish the current ray by writing its result and point count
+    * @param result result of the trace
+    */
+    void endRay(const TraceResult& result);
+
+    /*
+    * Function to close the path file
+    */
+    void close();
+};
+
+#endif // !__REFLECTIONPATH__HEADER__
@@ -0,0 +1,122 @@
+/*
+* Implementation file for RobustPredicates.cpp
+*/
+
+#include "RobustPredicates.h"
+
+#include <cmath>
+
+// 2^27 + 1, used to split a double into two halves of 26 bits
+const double splitter = 134217729.0;
+
+/*
+* Function to add two doubles exactly: high + low = a + b
+* @param a first number
+* @param b second number
+* @param high reference to set the rounded sum
+* @param low reference to set the roundoff error of the sum
+*/
+static void twoSum(double a, double b, double& high, double& low)
+{
+    high = a + b;
+    double bVirtual = high - a;
+    double aVirtual = high - bVirtual;
+    double bRoundoff = b - bVirtual;
+    double aRoundoff = a - aVirtual;
+    low = aRoundoff + bRoundoff;
+}
+
+/*
+* Function to split a double into two non overlapping halves
+* @param a number to split
+* @param high reference to set the upper 26 bits
+* @param low reference to set the lower 26 bits
+*/
+static void split(double a, double& high, double& low)
+{
+    double c = splitter * a;
+    double aBig = c - a;
+    high = c - aBig;
+    low = a - high;
+}
+
+/*
+* Function to multiply two doubles exactly: high + low = a * b
+* @param a first number
+* @param b second number
+* @param high reference to set the rounded product
+* @param low reference to set the roundoff error of the product
+*/
+static void twoProduct(double a, double b, double& high, double& low)
+{
+    high = a * b;
+    double aHigh, aLow, bHigh, bLow;
+    split(a, aHigh, aLow);
+    split(b, bHigh, bLow);
+    double error1 = high - (aHigh * bHigh);
+    double error2 = error1 - (aLow * bHigh);
+    double error3 = error2 - (aHigh * bLow);
+    low = (aLow * bLow) - error3;
+}
+
+/*
+* Function to add a double to an expansion (sum of non overlapping doubles, smallest first)
+* @param expansion components of the expansion, updated in place
+* @param length number of components, incremented by one
+* @param b number to add
+*/
+static void growExpansion(double* expansion, int& length, double b)
+{
+    double carry = b;
+    for (int i = 0; i < length; ++i)
+    {
+        double sum, roundoff;
+        twoSum(carry, expansion[i], sum, roundoff);
+        expansion[i] = roundoff;
+        carry = sum;
+    }
+    expansion[length++] = carry;
+}
+
+/*
+* Function to find the exact sign of dirX * (pointY - originY) - dirY * (pointX - originX)
+* Expanded into 4 products of the inputs so no subtraction is rounded
+*
+* @param originX x coordinate of the start of the ray
+* @param originY y coordinate of the start of the ray
+* @param dirX x component of the ray direction
+* @param dirY y component of the ray direction
+* @param pointX x coordinate of the point to check
+* @param pointY y coordinate of the point to check
+* Returns: 1 if the point is to the left of the ray, -1 if to the right, 0 if on the ray
+*/
+int exactRayOrientation(double originX, double originY, double dirX, double dirY, double pointX, double pointY)
+{
+    double products[4][2];
+    twoProduct(dirX, pointY, products[0][0], products[0][1]);
+    twoProduct(-dirX, originY, products[1][0], products[1][1]);
+    twoProduct(-dirY, pointX, products[2][0], products[2][1]);
+    twoProduct(dirY, originX, products[3][0], products[3][1]);
+
+    double expansion[8];
+    int length = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        growExpansion(expansion, length, products[i][1]);
+        growExpansion(expansion, length, products[i][0]);
+    }
+
+    // Components do not overlap => the sign is the sign of the largest non zero one
+    for (int i = length - 1; i >= 0; --i)
+    {
+        if (expansion[i] > 0)
+        {
+            return 1;
+        }
+        if (expansion[i] < 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
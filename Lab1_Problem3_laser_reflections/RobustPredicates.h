@@ -0,0 +1,69 @@
+/*
+* Header file for the robust geometric predicates
+*
+* The predicates are evaluated in double with a forward error bound first
+* (same bound as the orient2d filter of Shewchuk, "Adaptive Precision
+* Floating-Point Arithmetic and Fast Robust Geometric Predicates").
+* Only when the result is within the error bound the exact value is
+* computed with floating point expansions, so the sign is always exact
+* for the doubles passed in.
+*/
+
+#ifndef __ROBUSTPREDICATES__HEADER__
+#define __ROBUSTPREDICATES__HEADER__
+
+#include <cmath>
+
+// Half of the unit in the last place of 1.0 for double
+const double roundoffEpsilon = 1.1102230246251565e-16;
+// Relative error bound of the double evaluation: (3 + 16 eps) eps
+const double orientationErrorBound = (3.0 + 16.0 * roundoffEpsilon) * roundoffEpsilon;
+
+/*
+* Function to find the exact sign of dirX * (pointY - originY) - dirY * (pointX - originX)
+* Expanded into 4 products of the inputs so no subtraction is rounded
+*
+* @param originX x coordinate of the start of the ray
+* @param originY y coordinate of the start of the ray
+* @param dirX x component of the ray direction
+* @param dirY y component of the ray direction
+* @param pointX x coordinate of the point to check
+* @param pointY y coordinate of the point to check
+* Returns: 1 if the point is to the left of the ray, -1 if to the right, 0 if on the ray
+*/
+int exactRayOrientation(double originX, double originY, double dirX, double dirY, double pointX, double pointY);
+
+/*
+* Function to find on which side of a ray a point lies
+* Sign of direction x (point - origin), exact for the given doubles
+*
+* @param originX x coordinate of the start of the ray
+* @param originY y coordinate of the start of the ray
+* @param dirX x component of the ray direction
+* @param dirY y component of the ray direction
+* @param pointX x coordinate of the point to check
+* @param pointY y coordinate of the point to check
+* Returns: 1 if the point is to the left of the ray, -1 if to the right, 0 if on the ray
+*/
+inline int rayOrientation(double originX, double originY, double dirX, double dirY, double pointX, double pointY)
+{
+    // Fast path in double, kept inline so the hot loops stay branch light
+    double detLeft = dirX * (pointY - originY);
+    double detRight = dirY * (pointX - originX);
+    double determinant = detLeft - detRight;
+    double errorBound = orientationErrorBound * (std::fabs(detLeft) + std::fabs(detRight));
+
+    if (determinant > errorBound)
+    {
+        return 1;
+    }
+    if (-determinant > errorBound)
+    {
+        return -1;
+    }
+
+    // Result is too close to 0 to trust the double evaluation
+    return exactRayOrientation(originX, originY, dirX, dirY, pointX, pointY);
+}
+
+#endif // !__ROBUSTPREDICATES__HEADER__
@@ -0,0 +1,248 @@
+/*
+* Implementation file for SweepCache.cpp
+*/
+
+#include "SweepCache.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Version of the cache file format
+const std::uint32_t cacheVersion = 1;
+
+/*
+* Function to write the bytes of a value to a stream
+* @param out stream to write to
+* @param value value to write
+*/
+template <typename T>
+static void writeValue(std::ostream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/*
+* Function to read the bytes of a value from a stream
+* @param in stream to read from
+* @param value reference to set the value read
+* Return bool if the whole value was read
+*/
+template <typename T>
+static bool readValue(std::istream& in, T& value)
+{
+    return (bool)in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+/*
+* Function to write one result record to a stream
+* @param out stream to write to
+* @param key scaled parameter and decimals
+* @param result result of the trace
+*/
+static void writeRecord(std::ostream& out, const std::pair<long long, int>& key, const TraceResult& result)
+{
+    writeValue(out, (std::int64_t)key.first);
+    writeValue(out, (std::int32_t)key.second);
+    writeValue(out, (std::int32_t)result.status);
+    writeValue(out, (std::int64_t)result.reflectionCount);
+    writeValue(out, (std::int64_t)result.period);
+}
+
+/*
+* Function to get 10 to the power of digits
+* @param digits number of decimals
+* Return 10^digits
+*/
+static long double powerOfTen(int digits)
+{
+    long double power = 1;
+    for (int i = 0; i < digits; ++i)
+    {
+        power *= 10;
+    }
+    return power;
+}
+
+/*
+* Function to find the decimal resolution of a sweep
+* Smallest number of decimals which holds the first value and the step exactly
+* @param from first value of the sweep
+* @param to last value of the sweep
+* @param count number of values in the sweep
+* Return number of decimals, maxCacheDigits if no smaller one is exact
+*/
+int findSweepResolution(long double from, long double to, long long count)
+{
+    long double step = count > 1 ? (to - from) / (count - 1) : 0;
+    for (int digits = 0; digits < maxCacheDigits; ++digits)
+    {
+        long double scaledFrom = from * powerOfTen(digits);
+        long double scaledStep = step * powerOfTen(digits);
+        // Tolerance for the rounding of the decimal input to binary
+        if (fabsl(scaledFrom - roundl(scaledFrom)) < 1e-6L && fabsl(scaledStep - roundl(scaledStep)) < 1e-6L)
+        {
+            return digits;
+        }
+    }
+    return maxCacheDigits;
+}
+
+/*
+* Function to create the key of a parameter
+* @param value entry parameter
+* @param digits number of decimals to round the parameter to
+* Return scaled parameter and decimals, with trailing zeros dropped
+*/
+std::pair<long long, int> SweepCache::createKey(long double value, int digits)
+{
+    long long scaled = llroundl(value * powerOfTen(digits));
+    while (digits > 0 && scaled % 10 == 0)
+    {
+        scaled /= 10;
+        --digits;
+    }
+    return std::make_pair(scaled, digits);
+}
+
+/*
+* Function to round a parameter to the resolution of the cache
+* Rays are traced at the rounded value so a cached result is exact for its key
+* @param value entry parameter
+* @param digits number of decimals
+* Return parameter rounded to digits decimals
+*/
+long double SweepCache::roundParameter(long double value, int digits)
+{
+    std::pair<long long, int> key = createKey(value, digits);
+    return key.first / powerOfTen(key.second);
+}
+
+/*
+* Function to load the cache file and open it for new results
+* A file which is not a cache or is the cache of another cavity is left as it is
+* @param fileName name of the cache file, created if missing or empty
+* @param cavityKey text which identifies the cavity the results belong to
+* Return bool if the file could be opened, false for a file which is not a cache of the cavity
+*/
+bool SweepCache::open(const std::string& fileName, const std::string& cavityKey)
+{
+    this->table.clear();
+    bool validFile = false;
+    bool cutShort = false;
+
+    std::ifstream inFile(fileName.c_str(), std::ios::binary);
+    if (inFile.is_open() && inFile.peek() != std::ifstream::traits_type::eof())
+    {
+        char magic[4];
+        std::uint32_t version = 0;
+        std::uint32_t keyLength = 0;
+        if (inFile.read(magic, 4) && std::string(magic, 4) == "SWPC" && readValue(inFile, version) &&
+            version == cacheVersion && readValue(inFile, keyLength) && keyLength == cavityKey.size())
+        {
+            std::vector<char> fileKey(keyLength);
+            validFile = keyLength == 0 || (inFile.read(fileKey.data(), keyLength) &&
+                std::string(fileKey.begin(), fileKey.end()) == cavityKey);
+        }
+        if (not validFile)
+        {
+            // Not a cache, or the cache of another cavity or version: never overwrite it
+            return false;
+        }
+
+        // Later records replace earlier ones, a record cut short at the end is dropped
+        std::int64_t scaled, reflectionCount, period;
+        std::int32_t digits, status;
+        std::streamoff recordsEnd = inFile.tellg();
+        while (readValue(inFile, scaled) && readValue(inFile, digits) && readValue(inFile, status) &&
+            readValue(inFile, reflectionCount) && readValue(inFile, period))
+        {
+            TraceResult result = { reflectionCount, (traceStatus)status, period };
+            this->table[std::make_pair((long long)scaled, (int)digits)] = result;
+            recordsEnd = inFile.tellg();
+        }
+        inFile.clear();
+        inFile.seekg(0, std::ios::end);
+        cutShort = inFile.tellg() != recordsEnd;
+        inFile.close();
+    }
+
+    if (validFile && not cutShort)
+    {
+        this->appendFile.open(fileName.c_str(), std::ios::binary | std::ios::app);
+        return this->appendFile.is_open();
+    }
+
+    // Missing or empty file, start it
+    // A file ending in a cut short record is written again with the whole records only,
+    // appending after the cut would shift every later record
+    this->appendFile.open(fileName.c_str(), std::ios::binary | std::ios::trunc);
+    if (not this->appendFile.is_open())
+    {
+        return false;
+    }
+    this->appendFile.write("SWPC", 4);
+    writeValue(this->appendFile, cacheVersion);
+    writeValue(this->appendFile, (std::uint32_t)cavityKey.size());
+    this->appendFile.write(cavityKey.data(), cavityKey.size());
+    for (std::map<std::pair<long long, int>, TraceResult>::const_iterator it = this->table.begin();
+        it != this->table.end(); ++it)
+    {
+        writeRecord(this->appendFile, it->first, it->second);
+    }
+    this->appendFile.flush();
+    return (bool)this->appendFile;
+}
+
+/*
+* Function to look up the result of a ray
+* A result which ended before the budget is valid for any budget above its
+* reflections, a result which used up its budget only for the same budget
+* @param value entry parameter
+* @param digits number of decimals
+* @param reflectionBudget budget the ray would be traced with
+* @param result reference to set the cached result
+* Return bool if a result valid for the budget was found
+*/
+bool SweepCache::lookup(long double value, int digits, long long reflectionBudget, TraceResult& result) const
+{
+    std::map<std::pair<long long, int>, TraceResult>::const_iterator found =
+        this->table.find(createKey(value, digits));
+    if (found == this->table.end())
+    {
+        return false;
+    }
+
+    const TraceResult& cached = found->second;
+    bool valid = cached.status == traceBudgetExceeded ? cached.reflectionCount == reflectionBudget :
+        cached.reflectionCount < reflectionBudget;
+    if (valid)
+    {
+        result = cached;
+    }
+    return valid;
+}
+
+/*
+* Function to store the result of a ray
+* @param value entry parameter
+* @param digits number of decimals
+* @param result result of the trace
+*/
+void SweepCache::store(long double value, int digits, const TraceResult& result)
+{
+    std::pair<long long, int> key = createKey(value, digits);
+    this->table[key] = result;
+
+    // Flushed record by record so a sweep stopped part way keeps what it traced
+    writeRecord(this->appendFile, key, result);
+    this->appendFile.flush();
+}
+
+/*
+* Function to close the cache file
+*/
+void SweepCache::close()
+{
+    this->appendFile.close();
+}
@@ -0,0 +1,107 @@
+/*
+* Header file for the on disk cache of sweep results
+*
+* Results of the traced rays are stored in a table keyed by the entry
+* parameter at a decimal resolution: the parameter rounded to digits
+* decimals, with trailing zeros dropped so 0.5 at 1 digit and 0.50 at 2
+* digits are the same key. A zoomed in sweep with a finer step therefore
+* finds every ray of an earlier coarser sweep that lies on its grid.
+*
+* The reflection budget is not part of the key: a stored result is reused
+* whenever tracing with the new budget would have ended the same way.
+*
+* Cache file format (little endian, as written by the machine):
+*   char[4] "SWPC", uint32 version (1), uint32 length, length chars of the cavity key
+*   then records of int64 scaled parameter, int32 digits, int32 status,
+*   int64 reflectionCount, int64 period
+* A file which is not a cache, or the cache of another cavity, is never
+* overwritten: it is reported as an invalid input. A file ending in a
+* record cut short (sweep stopped while writing) is written again without
+* that record.
+*/
+
+#ifndef __SWEEPCACHE__HEADER__
+#define __SWEEPCACHE__HEADER__
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "TraceResult.h"
+
+// Max decimals of the parameter used as the cache resolution
+const int maxCacheDigits = 12;
+
+/*
+* Function to find the decimal resolution of a sweep
+* Smallest number of decimals which holds the first value and the step exactly
+* @param from first value of the sweep
+* @param to last value of the sweep
+* @param count number of values in the sweep
+* Return number of decimals, maxCacheDigits if no smaller one is exact
+*/
+int findSweepResolution(long double from, long double to, long long count);
+
+/*
+* Class to hold the sweep results on disk and in memory
+*/
+class SweepCache
+{
+    // Results by (parameter scaled to an integer, number of decimals)
+    std::map<std::pair<long long, int>, TraceResult> table;
+    // File the new results are appended to
+    std::ofstream appendFile;
+
+    /*
+    * Function to create the key of a parameter
+    * @param value entry parameter
+    * @param digits number of decimals to round the parameter to
+    * Return scaled parameter and decimals, with trailing zeros dropped
+    */
+    static std::pair<long long, int> createKey(long double value, int digits);
+
+public:
+    /*
+    * Function to load the cache file and open it for new results
+    * A file which is not a cache or is the cache of another cavity is left as it is
+    * @param fileName name of the cache file, created if missing or empty
+    * @param cavityKey text which identifies the cavity the results belong to
+    * Return bool if the file could be opened, false for a file which is not a cache of the cavity
+    */
+    bool open(const std::string& fileName, const std::string& cavityKey);
+
+    /*
+    * Function to round a parameter to the resolution of the cache
+    * Rays are traced at the rounded value so a cached result is exact for its key
+    * @param value entry parameter
+    * @param digits number of decimals
+    * Return parameter rounded to digits decimals
+    */
+    static long double roundParameter(long double value, int digits);
+
+    /*
+    * Function to look up the result of a ray
+    * @param value entry parameter
+    * @param digits number of decimals
+    * @param reflectionBudget budget the ray would be traced with
+    * @param result reference to set the cached result
+    * Return bool if a result valid for the budget was found
+    */
+    bool lookup(long double value, int digits, long long reflectionBudget, TraceResult& result) const;
+
+    /*
+    * Function to store the result of a ray
+    * @param value entry parameter
+    * @param digits number of decimals
+    * @param result result of the trace
+    */
+    void store(long double value, int digits, const TraceResult& result);
+
+    /*
+    * Function to close the cache file
+    */
+    void close();
+};
+
+#endif // !__SWEEPCACHE__HEADER__
@@ -0,0 +1,27 @@
+/*
+* Header file for the result of tracing a ray, shared by the 2D and 3D cavities
+*/
+
+#ifndef __TRACERESULT__HEADER__
+#define __TRACERESULT__HEADER__
+
+// Enum of the ways tracing a ray can end
+enum traceStatus
+{
+    traceEscaped,           // ray left through an exit segment or face
+    tracePeriodic,          // ray is on a periodic orbit and never escapes
+    traceBudgetExceeded,    // reflection budget used up before the ray escaped
+    traceFailed             // ray could not be traced (no edge or face ahead of it)
+};
+
+/*
+* Struct to hold the result of tracing a ray
+*/
+struct TraceResult
+{
+    long long reflectionCount;  // reflections before the ray escaped (or tracing stopped)
+    traceStatus status;         // how the trace ended
+    long long period;           // reflections in one period of a periodic orbit, 0 otherwise
+};
+
+#endif // !__TRACERESULT__HEADER__
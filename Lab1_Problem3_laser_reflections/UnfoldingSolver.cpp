@@ -0,0 +1,260 @@
+/*
+* Implementation file for UnfoldingSolver.cpp
+*/
+
+#include "UnfoldingSolver.h"
+
+#include <cmath>
+#include <cstring>
+
+/*
+* Function to find greatest common divisor
+*
+* @param a first number
+* @param b second number
+* Returns: gcd of a and b
+*/
+static long long greatestCommonDivisor(long long a, long long b)
+{
+    while (b != 0)
+    {
+        long long remainder = a % b;
+        a = b;
+        b = remainder;
+    }
+    return a;
+}
+
+/*
+* Function to count the positive integers k with k < num / den
+*
+* @param num numerator of the limit
+* @param den denominator of the limit (> 0)
+* Returns: count of the integers
+*/
+static long long countBelow(long long num, long long den)
+{
+    if (num <= 0)
+    {
+        return 0;
+    }
+    return (num - 1) / den;
+}
+
+/*
+* Function to convert a decimal string into an exact fraction numerator / 10^scale
+* Only plain decimals are accepted (optional '-', digits, optional '.' and digits)
+*
+* @param charsToCheck char array to convert
+* @param numerator reference to set the numerator of the fraction
+* @param scale reference to set the power of 10 in the denominator
+* @param maxScale max number of digits allowed after the decimal point
+* Returns: bool if the string could be converted exactly
+*/
+bool convertToFraction(const char* charsToCheck, long long& numerator, int& scale, int maxScale)
+{
+    const char* current = charsToCheck;
+    bool negative = false;
+    if (*current == '-')
+    {
+        negative = true;
+        ++current;
+    }
+
+    long long value = 0;
+    int digits = 0;
+    int fractionDigits = 0;
+    bool decimalPoint = false;
+
+    for (; *current != '\0'; ++current)
+    {
+        if (*current == '.')
+        {
+            if (decimalPoint)
+            {
+                // Two decimal points is not a plain decimal
+                return false;
+            }
+            decimalPoint = true;
+            continue;
+        }
+        if (not ::isdigit(*current))
+        {
+            return false;
+        }
+        if (decimalPoint)
+        {
+            ++fractionDigits;
+            if (fractionDigits > maxScale)
+            {
+                return false;
+            }
+        }
+        // Input is limited to |x| <= 10 so 18 digits can never overflow
+        if (++digits > 18)
+        {
+            return false;
+        }
+        value = value * 10 + (*current - '0');
+    }
+
+    if (digits == 0)
+    {
+        return false;
+    }
+
+    numerator = negative ? -value : value;
+    scale = fractionDigits;
+    return true;
+}
+
+/*
+* Function to find the smallest x >= 0 such that lower <= (a * x mod m) <= upper
+* Uses the euclid like reduction so the cost is O(log m)
+*
+* @param a multiplier
+* @param m modulus
+* @param lower lower limit of the residue (0 <= lower <= upper < m)
+* @param upper upper limit of the residue
+* Returns: smallest x or -1 if no x exists
+*/
+long long firstMultipleInRange(long long a, long long m, long long lower, long long upper)
+{
+    a %= m;
+    if (lower == 0)
+    {
+        return 0;
+    }
+    if (a == 0)
+    {
+        return -1;
+    }
+
+    // Check if a multiple of a falls directly in the range (no wrap around m)
+    long long x = (lower + a - 1) / a;
+    if (a * x <= upper)
+    {
+        return x;
+    }
+
+    // Otherwise a * x - m * y must fall in the range for the smallest y
+    // => (m * y) mod a has to fall in [-upper, -lower] mod a, which does not wrap
+    // as the range holds no multiple of a
+    long long y = firstMultipleInRange(m % a, a, (a - upper % a) % a, (a - lower % a) % a);
+    if (y == -1)
+    {
+        return -1;
+    }
+    return (m * y + lower + a - 1) / a;
+}
+
+/*
+* Function to count the reflections of the lab problem using the unfolded lattice
+* The incident ray starts at C and meets the side AB at x = numerator / 10^scale
+* Cost is O(log(10^scale)) and does not depend on the number of reflections
+*
+* Rays passing exactly through a vertex are counted the same as rays passing
+* right next to it, i.e. each of the 3 sides meeting there is one reflection
+*
+* @param numerator numerator of the x coordinate on AB (-10 <= x <= 10)
+* @param scale power of 10 in the denominator of the x coordinate
+* Returns: number of reflections before the ray escapes
+*/
+long long countReflectionsByUnfolding(long long numerator, int scale)
+{
+    long long denominator = 1;
+    for (int i = 0; i < scale; ++i)
+    {
+        denominator *= 10;
+    }
+
+    // Direction of the ray (x, 10sqrt3) in lattice coordinates is (10 + x, 10 - x) / 20
+    // Scale by the denominator and reduce to get the smallest integer direction (P, Q)
+    long long P = 10 * denominator + numerator;
+    long long Q = 10 * denominator - numerator;
+    long long divisor = greatestCommonDivisor(P, Q);
+    P /= divisor;
+    Q /= divisor;
+    // The ray crosses the line i + j = k at the k-th unit of time
+    // it crosses i = k at k * S / P and j = k at k * S / Q
+    long long S = P + Q;
+
+    // Escape happens when the ray crosses a lattice line within escapeDistance of a copy of C
+    // (y < 0.01 on the sides CA or CB of the original triangle)
+    const long double escapeDistance = 0.02 / sqrtl(3);
+
+    // For a copy of C at (m, n) with m + n = sigma the crossing of i + j = sigma is
+    // |P * n - Q * m| * 20 / S away from it, which is the closest of the 3 crossings
+    // Largest |P * n - Q * m| which still escapes
+    long long maxOffset = (long long)ceill(escapeDistance * S / 20) - 1;
+
+    // Copies of C have m = 2 * sigma (mod 3) so P * n - Q * m = (P - 2S) * sigma (mod 3S)
+    long long modulus = 3 * S;
+    long long multiplier = ((P - 2 * S) % modulus + modulus) % modulus;
+
+    // Smallest sigma for which the offset is small enough
+    // Exact hit of a copy of C always exists as the direction is rational
+    long long sigma = modulus / greatestCommonDivisor(multiplier, modulus);
+    if (maxOffset > 0)
+    {
+        long long nearBelow = firstMultipleInRange(multiplier, modulus, modulus - maxOffset, modulus - 1);
+        long long nearAbove = firstMultipleInRange(multiplier, modulus, 1, maxOffset);
+        if (nearBelow > 0 && nearBelow < sigma)
+        {
+            sigma = nearBelow;
+        }
+        if (nearAbove > 0 && nearAbove < sigma)
+        {
+            sigma = nearAbove;
+        }
+    }
+
+    // Offset and lattice position of the copy of C which the ray escapes through
+    long long offset = (multiplier * sigma) % modulus;
+    if (offset > modulus / 2)
+    {
+        offset -= modulus;
+    }
+    long long m = (P * sigma - offset) / S;
+    long long n = sigma - m;
+    long long absOffset = offset < 0 ? -offset : offset;
+
+    // Lattice line families crossed by the ray: i + j = k, i = k and j = k
+    // rate of a family is the number of its lines crossed per unit of time * S
+    long long rates[3] = { S, P, Q };
+    // Index of the line of each family through the copy of C
+    long long lineIndex[3] = { sigma, m, n };
+
+    // The ray escapes on the first crossing near the copy of C which is within escapeDistance
+    // Crossing of family f through the copy is at lineIndex[f] * S / rates[f]
+    int exitFamily = 0;
+    for (int family = 1; family < 3; ++family)
+    {
+        if (rates[family] == 0 || lineIndex[family] <= 0)
+        {
+            continue;
+        }
+        bool withinEscape = (long double)absOffset * 20 / rates[family] < escapeDistance;
+        // Compare lineIndex[f] / rates[f] < lineIndex[exit] / rates[exit]
+        bool earlier = lineIndex[family] * rates[exitFamily] < lineIndex[exitFamily] * rates[family];
+        if (withinEscape && earlier)
+        {
+            exitFamily = family;
+        }
+    }
+
+    // Every crossing before the escape is a reflection
+    long long reflectionCount = 0;
+    for (int family = 0; family < 3; ++family)
+    {
+        if (rates[family] == 0)
+        {
+            // The ray runs along this family of lines and never crosses it
+            continue;
+        }
+        // k * S / rates[family] < lineIndex[exit] * S / rates[exit]
+        reflectionCount += countBelow(lineIndex[exitFamily] * rates[family], rates[exitFamily]);
+    }
+
+    return reflectionCount;
+}
@@ -0,0 +1,59 @@
+/*
+* Header file for the billiard unfolding solver
+*
+* Reflecting the triangle across the side that was hit, instead of reflecting
+* the ray, turns the path of the laser into a straight line through the
+* triangular lattice made of copies of the triangle.
+* Every lattice edge crossed is one reflection and the ray escapes when it
+* crosses an edge close enough to a copy of the vertex C.
+*
+* Lattice coordinates used:
+*   (i, j) => i * CB + j * CA, so C = (0, 0), B = (1, 0) and A = (0, 1)
+*   lattice lines are i = k, j = k and i + j = k (images of the sides)
+*   copies of C are the lattice points with i = j (mod 3)
+*/
+
+#ifndef __UNFOLDINGSOLVER__HEADER__
+#define __UNFOLDINGSOLVER__HEADER__
+
+#include <string>
+
+/*
+* Function to convert a decimal string into an exact fraction numerator / 10^scale
+* Only plain decimals are accepted (optional '-', digits, optional '.' and digits)
+*
+* @param charsToCheck char array to convert
+* @param numerator reference to set the numerator of the fraction
+* @param scale reference to set the power of 10 in the denominator
+* @param maxScale max number of digits allowed after the decimal point
+* Returns: bool if the string could be converted exactly
+*/
+bool convertToFraction(const char* charsToCheck, long long& numerator, int& scale, int maxScale);
+
+/*
+* Function to find the smallest x >= 0 such that lower <= (a * x mod m) <= upper
+* Uses the euclid like reduction so the cost is O(log m)
+*
+* @param a multiplier
+* @param m modulus
+* @param lower lower limit of the residue (0 <= lower <= upper < m)
+* @param upper upper limit of the residue
+* Returns: smallest x or -1 if no x exists
+*/
+long long firstMultipleInRange(long long a, long long m, long long lower, long long upper);
+
+/*
+* Function to count the reflections of the lab problem using the unfolded lattice
+* The incident ray starts at C and meets the side AB at x = numerator / 10^scale
+* Cost is O(log(10^scale)) and does not depend on the number of reflections
+*
+* Rays passing exactly through a vertex are counted the same as rays passing
+* right next to it, i.e. each of the 3 sides meeting there is one reflection
+*
+* @param numerator numerator of the x coordinate on AB (-10 <= x <= 10)
+* @param scale power of 10 in the denominator of the x coordinate
+* Returns: number of reflections before the ray escapes
+*/
+long long countReflectionsByUnfolding(long long numerator, int scale);
+
+#endif // !__UNFOLDINGSOLVER__HEADER__
@@ -0,0 +1,162 @@
+/*
+* Implementation file for AntEstimators.cpp
+*/
+
+#include "AntEstimators.h"
+
+#include <algorithm>
+
+#include "AntMarkovSolver.h"
+
+/*
+* Constructor to create empty totals
+* @param width width of the grid, sets the number of last carries
+*/
+EstimatorTotals::EstimatorTotals(int width) :
+    runs(0), sumA(0), sumB(0), sumAA(0), sumBB(0), sumAB(0),
+    carryRuns((std::size_t)width * width, 0), carrySteps((std::size_t)width * width, 0)
+{
+}
+
+/*
+* Function to add the totals of other runs to these
+* @param other totals of the other runs
+*/
+void EstimatorTotals::add(const EstimatorTotals& other)
+{
+    this->runs += other.runs;
+    this->sumA += other.sumA;
+    this->sumB += other.sumB;
+    this->sumAA += other.sumAA;
+    this->sumBB += other.sumBB;
+    this->sumAB += other.sumAB;
+    for (std::size_t i = 0; i < this->carryRuns.size() && i < other.carryRuns.size(); ++i)
+    {
+        this->carryRuns[i] += other.carryRuns[i];
+        this->carrySteps[i] += other.carrySteps[i];
+    }
+}
+
+/*
+* Function to find an estimator from its name
+* @param name name of the estimator: plain, antithetic, control or conditional
+* @param estimator reference to set the estimator
+* Return bool if the name is an estimator
+*/
+bool findEstimator(const char* name, antEstimator& estimator)
+{
+    const antEstimator estimators[] = { plainRuns, antitheticRuns, controlVariateRuns, conditionalRuns };
+    for (std::size_t i = 0; i < sizeof(estimators) / sizeof(estimators[0]); ++i)
+    {
+        if (getEstimatorName(estimators[i]) == name)
+        {
+            estimator = estimators[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+* Function to get the name of an estimator
+* @param estimator estimator
+* Return name of the estimator
+*/
+std::string getEstimatorName(antEstimator estimator)
+{
+    switch (estimator)
+    {
+    case antitheticRuns:
+        return "antithetic";
+    case controlVariateRuns:
+        return "control";
+    case conditionalRuns:
+        return "conditional";
+    default:
+        return "plain";
+    }
+}
+
+/*
+* Function to solve for the exact values the estimators use
+* @param width width of the grid
+* @param height height of the grid
+* Return exact values of the grid
+*/
+EstimatorConstants createEstimatorConstants(int width, int height)
+{
+    AntMarkovSolver solver(width, height, width / 2, height / 2);
+    EstimatorConstants constants;
+    constants.width = width;
+    constants.firstDropSteps = solver.solveFirstDropSteps();
+    solver.solveLastCarry(constants.lastCarryMeans, constants.lastCarryVariances);
+    return constants;
+}
+
+/*
+* Function to work out the estimate from the totals of the runs
+* @param estimator estimator the runs were done with
+* @param constants exact values of the grid
+* @param totals totals of all the runs
+* Return estimate, variances and variance reduction factor
+*/
+EstimatorResult summarizeEstimator(antEstimator estimator, const EstimatorConstants& constants,
+    const EstimatorTotals& totals)
+{
+    EstimatorResult result = { 0, 0, 0, 0, 0 };
+    double runs = (double)totals.runs;
+    if (runs < 2)
+    {
+        return result;
+    }
+    result.runs = runs;
+
+    // Plain Monte Carlo on the steps walked
+    double sum = (double)totals.sumA;
+    result.mean = sum / runs;
+    result.plainVariance = std::max(0.0, ((double)totals.sumAA - sum * result.mean) / (runs - 1));
+    result.variance = result.plainVariance;
+
+    if (estimator == antitheticRuns)
+    {
+        // Variance of the pair means, one pair is two runs
+        double pairs = runs / 2;
+        double pairVariance = pairs > 1 ?
+            std::max(0.0, ((double)totals.sumBB - sum * sum / pairs) / 4 / (pairs - 1)) : 0;
+        result.variance = 2 * pairVariance;
+    }
+    else if (estimator == controlVariateRuns)
+    {
+        // Steps minus beta times the error of the steps till the first drop, beta fitted to the runs
+        double controlMean = (double)totals.sumB / runs;
+        double controlVariance = ((double)totals.sumBB - (double)totals.sumB * controlMean) / (runs - 1);
+        double covariance = ((double)totals.sumAB - sum * controlMean) / (runs - 1);
+        if (controlVariance > 0)
+        {
+            double beta = covariance / controlVariance;
+            result.mean -= beta * (controlMean - constants.firstDropSteps);
+            result.variance = std::max(0.0, result.plainVariance - covariance * beta);
+        }
+    }
+    else if (estimator == conditionalRuns)
+    {
+        // Steps walked plus the expected steps of the last carry
+        double estimateSum = sum;
+        double estimateSquares = (double)totals.sumAA;
+        double carryVariance = 0;
+        for (std::size_t i = 0; i < totals.carryRuns.size(); ++i)
+        {
+            double carryMean = constants.lastCarryMeans[i];
+            estimateSum += totals.carryRuns[i] * carryMean;
+            estimateSquares += 2 * carryMean * totals.carrySteps[i] + totals.carryRuns[i] * carryMean * carryMean;
+            carryVariance += totals.carryRuns[i] * constants.lastCarryVariances[i];
+        }
+        result.mean = estimateSum / runs;
+        result.variance = std::max(0.0, (estimateSquares - estimateSum * result.mean) / (runs - 1));
+        // Variance of the full walks: variance of the estimate plus the mean variance of the last carry
+        result.plainVariance = result.variance + carryVariance / runs;
+    }
+
+    result.reductionFactor = result.variance > 0 ? result.plainVariance / result.variance : 0;
+    return result;
+}
@@ -0,0 +1,300 @@
+/*
+* Header file for the variance reduction estimators of the expected steps
+*
+* antithetic:  run 2k walks the random stream of k and run 2k + 1 walks the
+*              same stream with every number complemented, the estimate is
+*              the mean of the pairs
+* control:     control variate on the steps till the first seed is dropped,
+*              whose expected value is known exactly (AntMarkovSolver)
+* conditional: the walk stops once the last seed is picked up and the
+*              steps of the last carry are replaced by their exact expected
+*              value for the pick up cell and the empty top row cell
+*
+* All the sums are integers so the estimates stay the same however the
+* runs are shared out. The variance of plain Monte Carlo is worked out
+* from the same runs, so each estimator reports how many plain runs one
+* of its runs is worth.
+*/
+
+#ifndef __ANTESTIMATORS__HEADER__
+#define __ANTESTIMATORS__HEADER__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "AntWalker.h"
+#include "RandomGenerators.h"
+#include "StepHistogram.h"
+
+/*
+* Enum of the estimators of the expected steps
+*/
+enum antEstimator
+{
+    plainRuns,
+    antitheticRuns,
+    controlVariateRuns,
+    conditionalRuns
+};
+
+/*
+* Struct to hold the exact values the estimators use
+*/
+struct EstimatorConstants
+{
+    int width;                              // width of the grid
+    double firstDropSteps;                  // expected steps till the first seed is dropped
+    std::vector<double> lastCarryMeans;     // expected steps of the last carry, at emptyColumn * width + pickUpColumn
+    std::vector<double> lastCarryVariances; // variances of the steps of the last carry, same order
+};
+
+/*
+* Struct to hold the integer sums of the runs of an estimator
+* antithetic:  sumA / sumAA steps of the runs, sumBB squared steps of the pairs
+* control:     sumA / sumAA steps of the runs, sumB / sumBB steps till the first drop, sumAB their products
+* conditional: sumA / sumAA steps walked, carryRuns / carrySteps runs and steps walked of every last carry
+*/
+struct EstimatorTotals
+{
+    unsigned long long runs;
+    unsigned long long sumA;
+    unsigned long long sumB;
+    unsigned long long sumAA;
+    unsigned long long sumBB;
+    unsigned long long sumAB;
+    std::vector<unsigned long long> carryRuns;
+    std::vector<unsigned long long> carrySteps;
+
+    /*
+    * Constructor to create empty totals
+    * @param width width of the grid, sets the number of last carries
+    */
+    explicit EstimatorTotals(int width = 0);
+
+    /*
+    * Function to add the totals of other runs to these
+    * @param other totals of the other runs
+    */
+    void add(const EstimatorTotals& other);
+};
+
+/*
+* Struct to hold the estimate of an estimator
+*/
+struct EstimatorResult
+{
+    double runs;                // number of runs
+    double mean;                // estimate of the expected steps
+    double variance;            // variance per run of the estimator
+    double plainVariance;       // variance per run of plain Monte Carlo, from the same runs
+    double reductionFactor;     // plainVariance / variance, plain runs one run of the estimator is worth
+};
+
+/*
+* Function to find an estimator from its name
+* @param name name of the estimator: plain, antithetic, control or conditional
+* @param estimator reference to set the estimator
+* Return bool if the name is an estimator
+*/
+bool findEstimator(const char* name, antEstimator& estimator);
+
+/*
+* Function to get the name of an estimator
+* @param estimator estimator
+* Return name of the estimator
+*/
+std::string getEstimatorName(antEstimator estimator);
+
+/*
+* Function to solve for the exact values the estimators use
+* @param width width of the grid
+* @param height height of the grid
+* Return exact values of the grid
+*/
+EstimatorConstants createEstimatorConstants(int width, int height);
+
+/*
+* Function to work out the estimate from the totals of the runs
+* @param estimator estimator the runs were done with
+* @param constants exact values of the grid
+* @param totals totals of all the runs
+* Return estimate, variances and variance reduction factor
+*/
+EstimatorResult summarizeEstimator(antEstimator estimator, const EstimatorConstants& constants,
+    const EstimatorTotals& totals);
+
+/*
+* Class for a generator which gives the complement of the numbers of another
+* Draws the mirror image u -> 1 - u of every bounded draw of the other generator
+*/
+template <typename Generator>
+class AntitheticGenerator
+{
+    Generator& generator;
+
+public:
+    typedef typename Generator::result_type result_type;
+
+    /*
+    * Constructor to wrap a generator
+    * @param inGenerator generator to complement
+    */
+    explicit AntitheticGenerator(Generator& inGenerator) : generator(inGenerator) {}
+
+    static constexpr result_type min() { return Generator::min(); }
+    static constexpr result_type max() { return Generator::max(); }
+
+    /*
+    * Function to get the next random number
+    * Return complement of the next number of the other generator
+    */
+    result_type operator()()
+    {
+        return ~this->generator();
+    }
+};
+
+/*
+* Struct to hold the steps at which the events of a run happen
+*/
+struct AntWalkEvents
+{
+    unsigned long firstDropStep;    // steps till the first seed is dropped
+    unsigned long lastPickUpStep;   // steps till the last seed is picked up
+    int lastPickUpColumn;           // column the last seed is picked up in
+    int emptyColumn;                // empty top row column when the last seed is picked up
+};
+
+/*
+* Function to run the problem once and record when the seeds are moved
+* Same walk as walkAnt, the branch for the events is only taken on a pick up or a drop
+*
+* @param table precomputed tables of the grid
+* @param randGenerator random number generator of the run
+* @param stopAtLastPickUp true to stop once the last seed is picked up
+* @param events reference to set the steps of the events
+* Return number of steps the ant took
+*/
+template <int Width, int Height, typename Generator>
+unsigned long walkAntEvents(const AntMoveTable<Width, Height>& table, Generator& randGenerator,
+    bool stopAtLastPickUp, AntWalkEvents& events)
+{
+    typedef AntGrid<Width, Height> Grid;
+
+    unsigned long steps = 0;
+    int cell = Grid::startCell;
+    std::uint32_t bottomSeeds = Grid::fullRowMask;
+    std::uint32_t topSeeds = 0;
+    std::uint32_t antHasSeed = 0;
+
+    while (topSeeds != Grid::fullRowMask)
+    {
+        cell = table.nextCell[cell][boundedRandom(randGenerator(), table.moveCount[cell])];
+
+        std::uint32_t pickUp = bottomSeeds & table.bottomBit[cell] & (antHasSeed - 1);
+        bottomSeeds ^= pickUp;
+        antHasSeed |= (std::uint32_t)(pickUp != 0);
+
+        std::uint32_t drop = table.topBit[cell] & ~topSeeds & (0u - antHasSeed);
+        topSeeds |= drop;
+        antHasSeed ^= (std::uint32_t)(drop != 0);
+
+        ++steps;
+
+        if ((pickUp | drop) == 0)
+        {
+            continue;
+        }
+        if (drop != 0 && topSeeds == drop)
+        {
+            events.firstDropStep = steps;
+        }
+        if (pickUp != 0 && bottomSeeds == 0)
+        {
+            events.lastPickUpStep = steps;
+            events.lastPickUpColumn = cell % Width;
+            // Only one top row column is still empty
+            std::uint32_t empty = Grid::fullRowMask & ~topSeeds;
+            events.emptyColumn = 0;
+            while ((empty >> events.emptyColumn) > 1)
+            {
+                ++events.emptyColumn;
+            }
+            if (stopAtLastPickUp)
+            {
+                break;
+            }
+        }
+    }
+    return steps;
+}
+
+/*
+* Function to do the runs firstRun to firstRun + numRuns - 1 with an estimator
+* Runs of the antithetic estimator come in pairs, so firstRun and numRuns must be even for it
+* Runs of the conditional estimator stop at the last pick up, so their steps are not whole
+* runs and are not added to the histogram
+*
+* @param estimator estimator to do the runs with
+* @param constants exact values of the grid
+* @param seed seed of the simulation
+* @param firstRun index of the first run
+* @param numRuns number of runs to do
+* @param totals reference to add the sums of the runs to
+* @param histogram reference to add the steps of the whole runs to
+*/
+template <int Width, int Height>
+void walkEstimatorRuns(antEstimator estimator, const EstimatorConstants& constants, std::uint64_t seed,
+    unsigned long long firstRun, unsigned long numRuns, EstimatorTotals& totals, StepHistogram& histogram)
+{
+    static const AntMoveTable<Width, Height> table;
+    (void)constants;
+    AntWalkEvents events = { 0, 0, 0, 0 };
+
+    for (unsigned long long run = firstRun; run < firstRun + numRuns; ++run)
+    {
+        if (estimator == antitheticRuns)
+        {
+            // Run and its antithetic partner on the stream of the pair
+            Xoshiro128StarStar randGenerator(seed, run / 2);
+            Xoshiro128StarStar partnerGenerator(seed, run / 2);
+            AntitheticGenerator<Xoshiro128StarStar> antitheticGenerator(partnerGenerator);
+            unsigned long long steps = walkAnt(table, randGenerator);
+            unsigned long long partnerSteps = walkAnt(table, antitheticGenerator);
+
+            totals.runs += 2;
+            totals.sumA += steps + partnerSteps;
+            totals.sumAA += steps * steps + partnerSteps * partnerSteps;
+            totals.sumBB += (steps + partnerSteps) * (steps + partnerSteps);
+            histogram.record((std::uint32_t)steps);
+            histogram.record((std::uint32_t)partnerSteps);
+            ++run;
+            continue;
+        }
+
+        Xoshiro128StarStar randGenerator(seed, run);
+        unsigned long long steps = walkAntEvents(table, randGenerator, estimator == conditionalRuns, events);
+        ++totals.runs;
+        totals.sumA += steps;
+        totals.sumAA += steps * steps;
+        if (estimator != conditionalRuns)
+        {
+            histogram.record((std::uint32_t)steps);
+        }
+        if (estimator == controlVariateRuns)
+        {
+            totals.sumB += events.firstDropStep;
+            totals.sumBB += (unsigned long long)events.firstDropStep * events.firstDropStep;
+            totals.sumAB += steps * events.firstDropStep;
+        }
+        else if (estimator == conditionalRuns)
+        {
+            int carry = events.emptyColumn * Width + events.lastPickUpColumn;
+            ++totals.carryRuns[carry];
+            totals.carrySteps[carry] += steps;
+        }
+    }
+}
+
+#endif // !__ANTESTIMATORS__HEADER__
@@ -0,0 +1,347 @@
+/*
+* Header file for the lane parallel ant walker and the grid kernels
+*
+* With AVX2 (compile with -mavx2 or -march=native) antLaneCount ants are
+* walked side by side in the 32 bit lanes of a register, with the state of
+* the ants kept as structure of arrays (column, row, seed masks, carrying
+* flag, steps). Every lane has its own xoshiro128** generator in a vector
+* register and every step advances all the lanes with masked updates: the
+* valid moves are worked out from the column and row, which is faster than
+* gathering them from the move tables. A lane whose run is finished is
+* given the next run and the generator of that run. Without AVX2 the runs
+* are done one after the other with walkAnt.
+*
+* Run i always uses the random stream of (seed, i) and draws its moves the
+* same way with and without AVX2, and the totals are integers, so the
+* totals of a range of runs do not depend on how the runs are shared out.
+*
+* The grid sizes with a compiled kernel are listed in findGridKernel, which
+* the simulation uses to pick the kernel of the grid asked for at run time.
+*/
+
+#ifndef __ANTLANES__HEADER__
+#define __ANTLANES__HEADER__
+
+#include <cstddef>
+#include <cstdint>
+
+#include "AntEstimators.h"
+#include "AntWalker.h"
+#include "RandomGenerators.h"
+#include "StepHistogram.h"
+
+// Number of ants walked side by side
+const int antLaneCount = 8;
+
+/*
+* Struct to hold the result of a batch of runs
+*/
+struct AntRunTotals
+{
+    unsigned long runs;             // number of runs finished
+    unsigned long long steps;       // steps of all the runs finished
+    unsigned long long squaredSteps; // sum of the squared steps of the runs finished
+};
+
+/*
+* Function to add the totals of other runs to a total
+* @param total totals to add to
+* @param other totals of the other runs
+*/
+inline void addRunTotals(AntRunTotals& total, const AntRunTotals& other)
+{
+    total.runs += other.runs;
+    total.steps += other.steps;
+    total.squaredSteps += other.squaredSteps;
+}
+
+#ifdef __AVX2__
+
+/*
+* Function to give a lane the random stream of a run
+* @param generatorStates generator state of the lanes, word i of lane j at [i][j]
+* @param lane lane to set
+* @param seed seed of the simulation
+* @param run index of the run
+*/
+inline void setLaneStream(std::uint32_t generatorStates[4][antLaneCount], int lane, std::uint64_t seed,
+    unsigned long long run)
+{
+    std::uint32_t state[4];
+    runStreamState(seed, run, state);
+    for (int i = 0; i < 4; ++i)
+    {
+        generatorStates[i][lane] = state[i];
+    }
+}
+
+/*
+* Function to do the runs firstRun to firstRun + numRuns - 1, 8 ants at a time in AVX2 lanes
+*
+* @param table precomputed tables of the grid, only used by the scalar version
+* @param seed seed of the simulation
+* @param firstRun index of the first run, picks the random streams of the runs
+* @param numRuns number of runs to do
+* @param histogram histogram to add the steps of the runs to
+* Return number of runs, their total steps and total squared steps
+*/
+template <int Width, int Height>
+AntRunTotals walkAntsInLanes(const AntMoveTable<Width, Height>& table, std::uint64_t seed,
+    unsigned long long firstRun, unsigned long numRuns, StepHistogram& histogram)
+{
+    typedef AntGrid<Width, Height> Grid;
+    (void)table;
+    AntRunTotals totals = { 0, 0, 0 };
+    Xoshiro128StarStarX8 laneGenerator;
+    // Generator state of the lanes, word i of lane j at generatorStates[i][j]
+    alignas(32) std::uint32_t generatorStates[4][antLaneCount];
+
+    // Lane state, also kept in arrays to restart the lanes which are done
+    alignas(32) std::int32_t columns[antLaneCount];
+    alignas(32) std::int32_t rows[antLaneCount];
+    alignas(32) std::uint32_t bottomMasks[antLaneCount];
+    alignas(32) std::uint32_t topMasks[antLaneCount];
+    alignas(32) std::uint32_t carrying[antLaneCount];
+    alignas(32) std::uint32_t steps[antLaneCount];
+    // All ones for a lane with a run in progress, 0 once there are no runs left for it
+    alignas(32) std::int32_t active[antLaneCount];
+
+    unsigned long runsStarted = 0;
+    for (int lane = 0; lane < antLaneCount; ++lane)
+    {
+        columns[lane] = Grid::startCell % Width;
+        rows[lane] = Grid::startCell / Width;
+        bottomMasks[lane] = Grid::fullRowMask;
+        topMasks[lane] = 0;
+        carrying[lane] = 0;
+        steps[lane] = 0;
+        active[lane] = runsStarted < numRuns ? -1 : 0;
+        setLaneStream(generatorStates, lane, seed, firstRun + runsStarted);
+        runsStarted += runsStarted < numRuns ? 1 : 0;
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        laneGenerator.state[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(generatorStates[i]));
+    }
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i full = _mm256_set1_epi32((int)Grid::fullRowMask);
+    const __m256i evenLanes = _mm256_set1_epi64x(0xFFFFFFFFLL);
+
+    // Column and row of the ant in each lane, the moves are worked out from them without table reads
+    __m256i column = _mm256_load_si256(reinterpret_cast<const __m256i*>(columns));
+    __m256i row = _mm256_load_si256(reinterpret_cast<const __m256i*>(rows));
+    __m256i bottom = _mm256_load_si256(reinterpret_cast<const __m256i*>(bottomMasks));
+    __m256i top = _mm256_load_si256(reinterpret_cast<const __m256i*>(topMasks));
+    __m256i carry = _mm256_load_si256(reinterpret_cast<const __m256i*>(carrying));
+    __m256i step = _mm256_load_si256(reinterpret_cast<const __m256i*>(steps));
+    __m256i running = _mm256_load_si256(reinterpret_cast<const __m256i*>(active));
+
+    // Last column and last row of the grid
+    const __m256i lastColumn = _mm256_set1_epi32(Width - 1);
+    const __m256i lastRow = _mm256_set1_epi32(Height - 1);
+
+    while (not _mm256_testz_si256(running, running))
+    {
+        // Valid moves in the order left, up, right, down (-1 if valid, 0 if not)
+        __m256i canLeft = _mm256_cmpgt_epi32(column, zero);
+        __m256i canUp = _mm256_cmpgt_epi32(lastRow, row);
+        __m256i canRight = _mm256_cmpgt_epi32(lastColumn, column);
+        __m256i canDown = _mm256_cmpgt_epi32(row, zero);
+        __m256i count = _mm256_sub_epi32(_mm256_sub_epi32(zero, _mm256_add_epi32(canLeft, canUp)),
+            _mm256_add_epi32(canRight, canDown));
+
+        // Bounded draw: upper 32 bits of random * moves, for the even and the odd 32 bit lanes
+        __m256i random = laneGenerator();
+        __m256i evenDraw = _mm256_srli_epi64(_mm256_mul_epu32(random, count), 32);
+        __m256i oddDraw = _mm256_mul_epu32(_mm256_srli_epi64(random, 32), _mm256_srli_epi64(count, 32));
+        __m256i draw = _mm256_blend_epi32(_mm256_and_si256(evenDraw, evenLanes), oddDraw, 0xAA);
+
+        // Move draw is the index among the valid moves: skip each valid move before it
+        __m256i goLeft = _mm256_and_si256(canLeft, _mm256_cmpeq_epi32(draw, zero));
+        draw = _mm256_add_epi32(draw, canLeft);
+        __m256i goUp = _mm256_and_si256(canUp, _mm256_cmpeq_epi32(draw, zero));
+        draw = _mm256_add_epi32(draw, canUp);
+        __m256i goRight = _mm256_and_si256(canRight, _mm256_cmpeq_epi32(draw, zero));
+        draw = _mm256_add_epi32(draw, canRight);
+        __m256i goDown = _mm256_and_si256(canDown, _mm256_cmpeq_epi32(draw, zero));
+        column = _mm256_add_epi32(column, _mm256_sub_epi32(goLeft, goRight));
+        row = _mm256_add_epi32(row, _mm256_sub_epi32(goDown, goUp));
+
+        __m256i columnBit = _mm256_sllv_epi32(one, column);
+        __m256i bottomBit = _mm256_and_si256(columnBit, _mm256_cmpeq_epi32(row, zero));
+        __m256i topBit = _mm256_and_si256(columnBit, _mm256_cmpeq_epi32(row, lastRow));
+
+        // Pick up: bottom row, not carrying and a seed in the cell
+        __m256i pickUp = _mm256_and_si256(_mm256_and_si256(bottom, bottomBit), _mm256_sub_epi32(carry, one));
+        bottom = _mm256_xor_si256(bottom, pickUp);
+        carry = _mm256_or_si256(carry, _mm256_andnot_si256(_mm256_cmpeq_epi32(pickUp, zero), one));
+
+        // Drop: top row, carrying and no seed in the cell
+        __m256i drop = _mm256_and_si256(_mm256_andnot_si256(top, topBit), _mm256_sub_epi32(zero, carry));
+        top = _mm256_or_si256(top, drop);
+        carry = _mm256_xor_si256(carry, _mm256_andnot_si256(_mm256_cmpeq_epi32(drop, zero), one));
+
+        // running is -1 for the lanes with a run in progress
+        step = _mm256_sub_epi32(step, running);
+
+        __m256i done = _mm256_and_si256(_mm256_cmpeq_epi32(top, full), running);
+        if (_mm256_testz_si256(done, done))
+        {
+            continue;
+        }
+
+        // Some runs are done: add them up and restart their lanes
+        _mm256_store_si256(reinterpret_cast<__m256i*>(columns), column);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(rows), row);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(bottomMasks), bottom);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(topMasks), top);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(carrying), carry);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(steps), step);
+        for (int i = 0; i < 4; ++i)
+        {
+            _mm256_store_si256(reinterpret_cast<__m256i*>(generatorStates[i]), laneGenerator.state[i]);
+        }
+        for (int lane = 0; lane < antLaneCount; ++lane)
+        {
+            if (active[lane] == 0 || topMasks[lane] != Grid::fullRowMask)
+            {
+                continue;
+            }
+            ++totals.runs;
+            totals.steps += steps[lane];
+            totals.squaredSteps += (unsigned long long)steps[lane] * steps[lane];
+            histogram.record(steps[lane]);
+
+            columns[lane] = Grid::startCell % Width;
+            rows[lane] = Grid::startCell / Width;
+            bottomMasks[lane] = Grid::fullRowMask;
+            topMasks[lane] = 0;
+            carrying[lane] = 0;
+            steps[lane] = 0;
+            if (runsStarted < numRuns)
+            {
+                setLaneStream(generatorStates, lane, seed, firstRun + runsStarted);
+                ++runsStarted;
+            }
+            else
+            {
+                // No runs left, the lane keeps moving but is not counted
+                active[lane] = 0;
+            }
+        }
+        column = _mm256_load_si256(reinterpret_cast<const __m256i*>(columns));
+        row = _mm256_load_si256(reinterpret_cast<const __m256i*>(rows));
+        bottom = _mm256_load_si256(reinterpret_cast<const __m256i*>(bottomMasks));
+        top = _mm256_load_si256(reinterpret_cast<const __m256i*>(topMasks));
+        carry = _mm256_load_si256(reinterpret_cast<const __m256i*>(carrying));
+        step = _mm256_load_si256(reinterpret_cast<const __m256i*>(steps));
+        running = _mm256_load_si256(reinterpret_cast<const __m256i*>(active));
+        for (int i = 0; i < 4; ++i)
+        {
+            laneGenerator.state[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(generatorStates[i]));
+        }
+    }
+    return totals;
+}
+
+#else
+
+/*
+* Function to do the runs firstRun to firstRun + numRuns - 1 without AVX2
+* Runs the ants one after the other with the move tables, which is the fastest on scalar code
+*
+* @param table precomputed tables of the grid
+* @param seed seed of the simulation
+* @param firstRun index of the first run, picks the random streams of the runs
+* @param numRuns number of runs to do
+* @param histogram histogram to add the steps of the runs to
+* Return number of runs, their total steps and total squared steps
+*/
+template <int Width, int Height>
+AntRunTotals walkAntsInLanes(const AntMoveTable<Width, Height>& table, std::uint64_t seed,
+    unsigned long long firstRun, unsigned long numRuns, StepHistogram& histogram)
+{
+    AntRunTotals totals = { 0, 0, 0 };
+    for (; totals.runs < numRuns; ++totals.runs)
+    {
+        Xoshiro128StarStar randGenerator(seed, firstRun + totals.runs);
+        unsigned long runSteps = walkAnt(table, randGenerator);
+        totals.steps += runSteps;
+        totals.squaredSteps += (unsigned long long)runSteps * runSteps;
+        histogram.record((std::uint32_t)runSteps);
+    }
+    return totals;
+}
+
+#endif // __AVX2__
+
+/*
+* Function to do a range of runs on a grid, the kernel of one grid size
+* The move tables are built on the first call
+*
+* @param seed seed of the simulation
+* @param firstRun index of the first run
+* @param numRuns number of runs to do
+* @param histogram histogram to add the steps of the runs to
+* Return number of runs, their total steps and total squared steps
+*/
+template <int Width, int Height>
+AntRunTotals walkGridRuns(std::uint64_t seed, unsigned long long firstRun, unsigned long numRuns,
+    StepHistogram& histogram)
+{
+    static const AntMoveTable<Width, Height> table;
+    return walkAntsInLanes(table, seed, firstRun, numRuns, histogram);
+}
+
+/*
+* Struct to hold the kernel compiled for a grid size
+*/
+struct AntGridKernel
+{
+    int width;
+    int height;
+    // Plain Monte Carlo runs in the lanes
+    AntRunTotals (*walkRuns)(std::uint64_t seed, unsigned long long firstRun, unsigned long numRuns,
+        StepHistogram& histogram);
+    // Runs of the variance reduction estimators
+    void (*walkEstimatorRuns)(antEstimator estimator, const EstimatorConstants& constants, std::uint64_t seed,
+        unsigned long long firstRun, unsigned long numRuns, EstimatorTotals& totals, StepHistogram& histogram);
+};
+
+/*
+* Function to find the kernel of a grid size
+* Every size in the table is compiled with its bounds and seed masks as
+* constants, add a line to run another size
+*
+* @param width width of the grid
+* @param height height of the grid
+* Return kernel of the grid, NULL if the size has no kernel
+*/
+inline const AntGridKernel* findGridKernel(int width, int height)
+{
+    static const AntGridKernel kernels[] =
+    {
+        { 3, 3, &walkGridRuns<3, 3>, &walkEstimatorRuns<3, 3> },
+        { 4, 4, &walkGridRuns<4, 4>, &walkEstimatorRuns<4, 4> },
+        { 5, 5, &walkGridRuns<5, 5>, &walkEstimatorRuns<5, 5> },
+        { 6, 6, &walkGridRuns<6, 6>, &walkEstimatorRuns<6, 6> },
+        { 7, 7, &walkGridRuns<7, 7>, &walkEstimatorRuns<7, 7> },
+        { 8, 8, &walkGridRuns<8, 8>, &walkEstimatorRuns<8, 8> },
+        { 10, 10, &walkGridRuns<10, 10>, &walkEstimatorRuns<10, 10> },
+        { 12, 12, &walkGridRuns<12, 12>, &walkEstimatorRuns<12, 12> },
+        { 16, 16, &walkGridRuns<16, 16>, &walkEstimatorRuns<16, 16> },
+        { 20, 20, &walkGridRuns<20, 20>, &walkEstimatorRuns<20, 20> }
+    };
+    for (std::size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); ++i)
+    {
+        if (kernels[i].width == width && kernels[i].height == height)
+        {
+            return &kernels[i];
+        }
+    }
+    return NULL;
+}
+
+#endif // !__ANTLANES__HEADER__
@@ -0,0 +1,328 @@
+/*
+* Implementation file for AntMarkovSolver.cpp
+*/
+
+#include "AntMarkovSolver.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+/*
+* Function to get the next larger mask with the same number of set bits (Gosper's hack)
+* @param mask mask with at least one set bit
+* Return next mask, may be above the masks of the row when there is none left
+*/
+static std::uint64_t nextMaskSameBits(std::uint64_t mask)
+{
+    std::uint64_t lowest = mask & (~mask + 1);
+    std::uint64_t ripple = mask + lowest;
+    return (((ripple ^ mask) >> 2) / lowest) | ripple;
+}
+
+/*
+* Constructor to create the solver for a grid
+* @param inWidth width of the grid, 1 to maxSolverWidth
+* @param inHeight height of the grid, at least 2
+* @param startX column the ant starts in
+* @param startY row the ant starts in
+*/
+AntMarkovSolver::AntMarkovSolver(int inWidth, int inHeight, int startX, int startY) :
+    width(inWidth), height(inHeight), startCell(startX + startY * inWidth), phaseCount(0)
+{
+    int cellCount = this->width * this->height;
+    this->neighbours.resize(cellCount);
+    for (int cell = 0; cell < cellCount; ++cell)
+    {
+        int x = cell % this->width;
+        int y = cell / this->width;
+        if (x > 0)
+        {
+            this->neighbours[cell].push_back(cell - 1);
+        }
+        if (y < this->height - 1)
+        {
+            this->neighbours[cell].push_back(cell + this->width);
+        }
+        if (x < this->width - 1)
+        {
+            this->neighbours[cell].push_back(cell + 1);
+        }
+        if (y > 0)
+        {
+            this->neighbours[cell].push_back(cell - this->width);
+        }
+    }
+}
+
+/*
+* Function to get the banded LU factors of a phase matrix, factorized on first use
+* Matrix is I - Q, Q the moves which stay in the phase, stored as rows of 2 * width + 1
+* @param antHasSeed 1 if the ant carries a seed in the phase
+* @param exitColumns mask of the columns where the ant changes phase,
+*                    in the bottom row when not carrying, else in the top row
+* Return banded LU factors
+*/
+const std::vector<double>& AntMarkovSolver::getFactorization(int antHasSeed, std::uint32_t exitColumns)
+{
+    std::uint64_t key = ((std::uint64_t)antHasSeed << 32) | exitColumns;
+    std::map<std::uint64_t, std::vector<double> >::iterator found = this->factorizationCache.find(key);
+    if (found != this->factorizationCache.end())
+    {
+        return found->second;
+    }
+
+    int cellCount = this->width * this->height;
+    int bandwidth = this->width;
+    int rowLength = 2 * bandwidth + 1;
+    int exitRow = antHasSeed ? this->height - 1 : 0;
+    std::vector<double>& band = this->factorizationCache[key];
+    band.assign((std::size_t)cellCount * rowLength, 0.0);
+
+    // Element (i, j) is at band[i * rowLength + j - i + bandwidth]
+    for (int cell = 0; cell < cellCount; ++cell)
+    {
+        band[cell * rowLength + bandwidth] = 1;
+        double probability = 1.0 / this->neighbours[cell].size();
+        for (std::size_t i = 0; i < this->neighbours[cell].size(); ++i)
+        {
+            int next = this->neighbours[cell][i];
+            bool exits = next / this->width == exitRow && (exitColumns >> (next % this->width) & 1);
+            if (not exits)
+            {
+                band[cell * rowLength + next - cell + bandwidth] -= probability;
+            }
+        }
+    }
+
+    // Gaussian elimination inside the band, no pivoting needed as the matrix is diagonally dominant
+    for (int k = 0; k < cellCount; ++k)
+    {
+        double pivot = band[k * rowLength + bandwidth];
+        int lastRow = std::min(cellCount - 1, k + bandwidth);
+        for (int i = k + 1; i <= lastRow; ++i)
+        {
+            double& lower = band[i * rowLength + k - i + bandwidth];
+            if (lower == 0)
+            {
+                continue;
+            }
+            lower /= pivot;
+            for (int j = k + 1; j <= lastRow; ++j)
+            {
+                band[i * rowLength + j - i + bandwidth] -= lower * band[k * rowLength + j - k + bandwidth];
+            }
+        }
+    }
+    return band;
+}
+
+/*
+* Function to solve the system of a phase with its LU factors
+* @param factors banded LU factors of the phase matrix
+* @param values right hand side, overwritten by the solution
+*/
+void AntMarkovSolver::solveFactorized(const std::vector<double>& factors, std::vector<double>& values) const
+{
+    int cellCount = this->width * this->height;
+    int bandwidth = this->width;
+    int rowLength = 2 * bandwidth + 1;
+
+    // Forward substitution with the unit lower factor
+    for (int i = 0; i < cellCount; ++i)
+    {
+        for (int k = std::max(0, i - bandwidth); k < i; ++k)
+        {
+            values[i] -= factors[i * rowLength + k - i + bandwidth] * values[k];
+        }
+    }
+    // Back substitution with the upper factor
+    for (int i = cellCount - 1; i >= 0; --i)
+    {
+        int lastColumn = std::min(cellCount - 1, i + bandwidth);
+        for (int j = i + 1; j <= lastColumn; ++j)
+        {
+            values[i] -= factors[i * rowLength + j - i + bandwidth] * values[j];
+        }
+        values[i] /= factors[i * rowLength + bandwidth];
+    }
+}
+
+/*
+* Function to solve for the expected number of steps
+* The phases are solved level by level, a level being 2 * (seeds in the top row) + carrying,
+* from the last level (all seeds placed, 0 steps left) back to the start
+* Return expected number of steps till all the seeds are in the top row
+*/
+double AntMarkovSolver::solveExpectedSteps()
+{
+    int cellCount = this->width * this->height;
+    std::uint32_t fullMask = (std::uint32_t)((1ULL << this->width) - 1);
+    this->phaseCount = 0;
+
+    // Expected steps left from every cell of each phase of the level after the current one
+    // Phase key is (bottom row mask << 32) | top row mask, the carrying flag follows from the level
+    std::unordered_map<std::uint64_t, std::vector<double> > nextLevel;
+    std::unordered_map<std::uint64_t, std::vector<double> > currentLevel;
+    std::vector<double> values(cellCount);
+
+    for (int level = 2 * this->width - 1; level >= 0; --level)
+    {
+        int antHasSeed = level % 2;
+        int topCount = level / 2;
+        int bottomCount = this->width - topCount - antHasSeed;
+        currentLevel.clear();
+
+        // Every top mask with topCount seeds and bottom mask with bottomCount seeds
+        for (std::uint64_t topMask = (1ULL << topCount) - 1; topMask <= fullMask;
+            topMask = topCount == 0 ? fullMask + 1ULL : nextMaskSameBits(topMask))
+        {
+            std::uint32_t top = (std::uint32_t)topMask;
+            for (std::uint64_t bottomMask = (1ULL << bottomCount) - 1; bottomMask <= fullMask;
+                bottomMask = bottomCount == 0 ? fullMask + 1ULL : nextMaskSameBits(bottomMask))
+            {
+                std::uint32_t bottom = (std::uint32_t)bottomMask;
+
+                // Ant picks up from the bottom row seeds, or drops on the empty top row cells
+                std::uint32_t exitColumns = antHasSeed ? (fullMask & ~top) : bottom;
+                int exitRow = antHasSeed ? this->height - 1 : 0;
+
+                for (int cell = 0; cell < cellCount; ++cell)
+                {
+                    values[cell] = 1;
+                    double probability = 1.0 / this->neighbours[cell].size();
+                    for (std::size_t i = 0; i < this->neighbours[cell].size(); ++i)
+                    {
+                        int next = this->neighbours[cell][i];
+                        std::uint32_t column = 1u << (next % this->width);
+                        if (next / this->width != exitRow || not (exitColumns & column))
+                        {
+                            continue;
+                        }
+                        // Next phase after picking up or dropping the seed in the column
+                        std::uint32_t nextBottom = antHasSeed ? bottom : (bottom ^ column);
+                        std::uint32_t nextTop = antHasSeed ? (top | column) : top;
+                        if (nextTop == fullMask)
+                        {
+                            // All seeds placed, no steps left
+                            continue;
+                        }
+                        const std::vector<double>& nextValues =
+                            nextLevel[((std::uint64_t)nextBottom << 32) | nextTop];
+                        values[cell] += probability * nextValues[next];
+                    }
+                }
+
+                solveFactorized(getFactorization(antHasSeed, exitColumns), values);
+                currentLevel[((std::uint64_t)bottom << 32) | top] = values;
+                ++this->phaseCount;
+            }
+        }
+        nextLevel.swap(currentLevel);
+    }
+
+    // Only the start phase is left: all seeds in the bottom row, none carried
+    return nextLevel[(std::uint64_t)fullMask << 32][this->startCell];
+}
+
+/*
+* Function to solve for the expected number of steps till the first seed is dropped
+* The ant first carries a seed from wherever it picks it up to any top row
+* cell, which does not depend on the column the seed came from, then the
+* phase before it is solved with those steps at the bottom row cells
+* Works for grids up to 32 wide, it only solves the first two phases
+* Return expected number of steps till a seed is in the top row
+*/
+double AntMarkovSolver::solveFirstDropSteps()
+{
+    int cellCount = this->width * this->height;
+    std::uint32_t fullMask = (std::uint32_t)((1ULL << this->width) - 1);
+
+    // Carrying the first seed: every top row cell ends the walk
+    std::vector<double> carrySteps(cellCount, 1.0);
+    solveFactorized(getFactorization(1, fullMask), carrySteps);
+
+    // Not carrying: every bottom row cell has a seed and starts the carry
+    std::vector<double> values(cellCount);
+    for (int cell = 0; cell < cellCount; ++cell)
+    {
+        values[cell] = 1;
+        double probability = 1.0 / this->neighbours[cell].size();
+        for (std::size_t i = 0; i < this->neighbours[cell].size(); ++i)
+        {
+            int next = this->neighbours[cell][i];
+            if (next < this->width)
+            {
+                values[cell] += probability * carrySteps[next];
+            }
+        }
+    }
+    solveFactorized(getFactorization(0, fullMask), values);
+    return values[this->startCell];
+}
+
+/*
+* Function to solve for the steps of the last carry, from the cell where
+* the last seed is picked up to the one empty cell of the top row
+* With E the expected steps and Q the moves which do not end the carry,
+* the second moment M of the steps solves (I - Q) M = 1 + 2 Q E
+* Works for grids up to 32 wide
+* @param means reference to set the expected steps, at emptyColumn * width + pickUpColumn
+* @param variances reference to set the variances of the steps, same order as the means
+*/
+void AntMarkovSolver::solveLastCarry(std::vector<double>& means, std::vector<double>& variances)
+{
+    int cellCount = this->width * this->height;
+    means.assign((std::size_t)this->width * this->width, 0.0);
+    variances.assign((std::size_t)this->width * this->width, 0.0);
+
+    for (int emptyColumn = 0; emptyColumn < this->width; ++emptyColumn)
+    {
+        const std::vector<double>& factors = getFactorization(1, 1u << emptyColumn);
+        int emptyCell = emptyColumn + (this->height - 1) * this->width;
+
+        std::vector<double> steps(cellCount, 1.0);
+        solveFactorized(factors, steps);
+
+        std::vector<double> squaredSteps(cellCount);
+        for (int cell = 0; cell < cellCount; ++cell)
+        {
+            squaredSteps[cell] = 1;
+            double probability = 1.0 / this->neighbours[cell].size();
+            for (std::size_t i = 0; i < this->neighbours[cell].size(); ++i)
+            {
+                int next = this->neighbours[cell][i];
+                if (next != emptyCell)
+                {
+                    squaredSteps[cell] += 2 * probability * steps[next];
+                }
+            }
+        }
+        solveFactorized(factors, squaredSteps);
+
+        // The last seed is picked up in the bottom row, cell x is column x
+        for (int column = 0; column < this->width; ++column)
+        {
+            means[emptyColumn * this->width + column] = steps[column];
+            variances[emptyColumn * this->width + column] =
+                std::max(0.0, squaredSteps[column] - steps[column] * steps[column]);
+        }
+    }
+}
+
+/*
+* Getter for the number of phases solved
+* Return number of phases solved by the last solve
+*/
+unsigned long AntMarkovSolver::getPhaseCount() const
+{
+    return this->phaseCount;
+}
+
+/*
+* Getter for the number of different phase matrices factorized
+* Return number of cached factorizations
+*/
+unsigned long AntMarkovSolver::getFactorizationCount() const
+{
+    return (unsigned long)this->factorizationCache.size();
+}
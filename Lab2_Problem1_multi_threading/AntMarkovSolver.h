@@ -0,0 +1,107 @@
+/*
+* Header file for the exact solver of the ant and seeds problem
+*
+* The problem is an absorbing Markov chain on the states
+* (ant cell, bottom row seed mask, top row seed mask, carrying flag).
+* The seed masks and the carrying flag (the phase) only change when the
+* ant picks up or drops a seed, and every change moves one step further
+* along 2 * (seeds in the top row) + carrying. The phases are solved from
+* the last one back to the first, each one as a linear system over the
+* cells of the grid:
+*   E[c] = 1 + sum over the moves c -> n of E[n] / moves(c)
+* where E[n] comes from the next phase when the ant picks up or drops a
+* seed at n. The matrix of a phase only depends on which cells make the
+* ant change phase, so its factorization is computed once and reused.
+* With the cells numbered row by row the matrix is banded with the grid
+* width as bandwidth, and it is diagonally dominant, so a banded LU
+* without pivoting is exact to rounding.
+*/
+
+#ifndef __ANTMARKOVSOLVER__HEADER__
+#define __ANTMARKOVSOLVER__HEADER__
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Max grid width, the seed masks of a row are 32 bit
+const int maxSolverWidth = 16;
+
+/*
+* Class to find the exact expected number of steps of the ant
+* Seeds start in every cell of the bottom row and go to the top row
+*/
+class AntMarkovSolver
+{
+    int width;
+    int height;
+    int startCell;
+    // Cells reached by the moves of each cell, a cell is x + y * width
+    std::vector<std::vector<int> > neighbours;
+    // Banded LU factors of the phase matrix by (carrying flag, cells which change the phase)
+    std::map<std::uint64_t, std::vector<double> > factorizationCache;
+    // Number of phases solved by the last solve
+    unsigned long phaseCount;
+
+    /*
+    * Function to get the banded LU factors of a phase matrix, factorized on first use
+    * @param antHasSeed 1 if the ant carries a seed in the phase
+    * @param exitColumns mask of the columns where the ant changes phase,
+    *                    in the bottom row when not carrying, else in the top row
+    * Return banded LU factors
+    */
+    const std::vector<double>& getFactorization(int antHasSeed, std::uint32_t exitColumns);
+
+    /*
+    * Function to solve the system of a phase with its LU factors
+    * @param factors banded LU factors of the phase matrix
+    * @param values right hand side, overwritten by the solution
+    */
+    void solveFactorized(const std::vector<double>& factors, std::vector<double>& values) const;
+
+public:
+    /*
+    * Constructor to create the solver for a grid
+    * @param inWidth width of the grid, 1 to maxSolverWidth
+    * @param inHeight height of the grid, at least 2
+    * @param startX column the ant starts in
+    * @param startY row the ant starts in
+    */
+    AntMarkovSolver(int inWidth, int inHeight, int startX, int startY);
+
+    /*
+    * Function to solve for the expected number of steps
+    * Return expected number of steps till all the seeds are in the top row
+    */
+    double solveExpectedSteps();
+
+    /*
+    * Function to solve for the expected number of steps till the first seed is dropped
+    * Works for grids up to 32 wide, it only solves the first two phases
+    * Return expected number of steps till a seed is in the top row
+    */
+    double solveFirstDropSteps();
+
+    /*
+    * Function to solve for the steps of the last carry, from the cell where
+    * the last seed is picked up to the one empty cell of the top row
+    * Works for grids up to 32 wide
+    * @param means reference to set the expected steps, at emptyColumn * width + pickUpColumn
+    * @param variances reference to set the variances of the steps, same order as the means
+    */
+    void solveLastCarry(std::vector<double>& means, std::vector<double>& variances);
+
+    /*
+    * Getter for the number of phases solved
+    * Return number of phases solved by the last solve
+    */
+    unsigned long getPhaseCount() const;
+
+    /*
+    * Getter for the number of different phase matrices factorized
+    * Return number of cached factorizations
+    */
+    unsigned long getFactorizationCount() const;
+};
+
+#endif // !__ANTMARKOVSOLVER__HEADER__
@@ -0,0 +1,142 @@
+/*
+* Header file for the ant and seeds walker
+*
+* The ant moves on a width x height grid, starting in the middle cell. It
+* picks up a seed from the bottom row when it is not carrying one and
+* drops it on an empty cell of the top row, till a seed is in every cell
+* of the top row. The lab grid is 5 x 5.
+*
+* The grid size is a template parameter, so the bounds of the grid and the
+* width of the seed masks are constants in every kernel. The moves of every
+* cell are precomputed, so each step is one bounded random draw and a table
+* lookup instead of drawing one of the 4 directions and drawing again when
+* it leaves the grid. The seeds of each row are kept as bits of a mask and
+* are picked up and dropped without branches.
+*/
+
+#ifndef __ANTWALKER__HEADER__
+#define __ANTWALKER__HEADER__
+
+#include <cstdint>
+
+#include "RandomGenerators.h"
+
+// Width and height of the lab grid
+const int gridSize = 5;
+// Max grid width, the seed masks of a row are 32 bit
+const int maxGridWidth = 32;
+
+/*
+* Struct to hold the constants of a grid
+* Width x Height cells, a cell is x + y * Width. The seeds start in every
+* cell of the bottom row (row 0) and go to the top row (row Height - 1)
+*/
+template <int Width, int Height>
+struct AntGrid
+{
+    static_assert(Width >= 1 && Width <= maxGridWidth, "seed masks are 32 bit");
+    static_assert(Height >= 2, "seed rows must be different");
+
+    // Number of cells in the grid
+    static const int cellCount = Width * Height;
+    // Cell the ant starts in, the middle of the grid
+    static const int startCell = Width / 2 + Height / 2 * Width;
+    // Mask with a bit for every column of a row, the seeds are in the bottom row at the start
+    static const std::uint32_t fullRowMask = (std::uint32_t)((1ULL << Width) - 1);
+};
+
+/*
+* Struct to hold the precomputed tables of a grid
+*/
+template <int Width, int Height>
+struct AntMoveTable
+{
+    typedef AntGrid<Width, Height> Grid;
+
+    // Number of valid moves from each cell: 2 in a corner, 3 on a side, 4 inside
+    std::uint32_t moveCount[Grid::cellCount];
+    // Cells reached by the valid moves of each cell
+    std::uint16_t nextCell[Grid::cellCount][4];
+    // Bit of the column for the cells of the bottom row, 0 for other cells
+    std::uint32_t bottomBit[Grid::cellCount];
+    // Bit of the column for the cells of the top row, 0 for other cells
+    std::uint32_t topBit[Grid::cellCount];
+
+    /*
+    * Constructor to fill the tables
+    */
+    AntMoveTable()
+    {
+        for (int cell = 0; cell < Grid::cellCount; ++cell)
+        {
+            int x = cell % Width;
+            int y = cell / Width;
+            std::uint32_t count = 0;
+
+            // Same order as the directions: left, up, right, down
+            if (x > 0)
+            {
+                this->nextCell[cell][count++] = (std::uint16_t)(cell - 1);
+            }
+            if (y < Height - 1)
+            {
+                this->nextCell[cell][count++] = (std::uint16_t)(cell + Width);
+            }
+            if (x < Width - 1)
+            {
+                this->nextCell[cell][count++] = (std::uint16_t)(cell + 1);
+            }
+            if (y > 0)
+            {
+                this->nextCell[cell][count++] = (std::uint16_t)(cell - Width);
+            }
+            this->moveCount[cell] = count;
+
+            this->bottomBit[cell] = y == 0 ? 1u << x : 0;
+            this->topBit[cell] = y == Height - 1 ? 1u << x : 0;
+        }
+    }
+};
+
+/*
+* Function to run the problem once
+* Moves the ant till all the seeds have been moved from the bottom row to the top row
+*
+* @param table precomputed tables of the grid
+* @param randGenerator random number generator of the run
+* Return number of steps the ant took
+*/
+template <int Width, int Height, typename Generator>
+unsigned long walkAnt(const AntMoveTable<Width, Height>& table, Generator& randGenerator)
+{
+    typedef AntGrid<Width, Height> Grid;
+
+    unsigned long steps = 0;
+    int cell = Grid::startCell;
+    // Seeds still in the bottom row and seeds placed in the top row
+    std::uint32_t bottomSeeds = Grid::fullRowMask;
+    std::uint32_t topSeeds = 0;
+    // 1 if the ant is carrying a seed
+    std::uint32_t antHasSeed = 0;
+
+    while (topSeeds != Grid::fullRowMask)
+    {
+        cell = table.nextCell[cell][boundedRandom(randGenerator(), table.moveCount[cell])];
+
+        // Pick up: bottom row, not carrying and a seed in the cell
+        // (antHasSeed - 1) is all ones when the ant is not carrying a seed
+        std::uint32_t pickUp = bottomSeeds & table.bottomBit[cell] & (antHasSeed - 1);
+        bottomSeeds ^= pickUp;
+        antHasSeed |= (std::uint32_t)(pickUp != 0);
+
+        // Drop: top row, carrying and no seed in the cell
+        std::uint32_t drop = table.topBit[cell] & ~topSeeds & (0u - antHasSeed);
+        topSeeds |= drop;
+        antHasSeed ^= (std::uint32_t)(drop != 0);
+
+        ++steps;
+    }
+    return steps;
+}
+
+#endif // !__ANTWALKER__HEADER__
@@ -2,6 +2,26 @@
 Description:
     Solution file for Problem 1 in Lab 2.
     Implemented the ant and seeds problem using standard threading library
+
+    Usage:
+        ./sim                               -> Monte Carlo estimate on all the cores
+        ./sim --exact [--grid <w> <h>]      -> exact expected steps from the Markov chain (see AntMarkovSolver.h),
+                                               for the lab 5 x 5 grid or a w x h grid with the ant starting in the middle
+        --grid <w> <h> also sets the grid of the Monte Carlo modes, for the sizes with a kernel in findGridKernel
+        ./sim --tolerance <t> [--batch <n>] -> Monte Carlo till the 95% confidence half width of the mean is below t,
+                                               threads merge their statistics every n runs (default 10000)
+        --batch <n> also sets the runs per chunk of the work stealing scheduler of the default mode
+        --estimator <name> runs the default or the tolerance mode with a variance reduction estimator
+                   (see AntEstimators.h): plain, antithetic, control or conditional, and reports its variance
+                   reduction factor, the tolerance mode stops on the confidence interval of the estimator
+                   (antithetic pairs have more variance than plain runs on this grid, the output warns of it)
+        --threads <n> sets the number of threads (default all the cpus)
+        --pin <none|cores|nodes> pins every thread to its own cpu or to the NUMA node of that cpu, cores first,
+                   then their SMT siblings (see ThreadPlacement.h)
+        ./sim --scaling                     -> runs scalingRuns runs on 1 to --threads threads and reports runs per
+                                               second, speedup, efficiency and the threads on SMT siblings
+        --seed <n> sets the seed of the Monte Carlo modes (default from std::random_device), run i always
+                   uses the random stream of (seed, i), so a seed gives the same result on any number of threads
 */
 
 #include <iostream>
@@ -11,171 +31,601 @@ Description:
 #include <mutex>
 #include <algorithm>
 #include <cmath>
-#include <array>
 #include <fstream>
 #include <iomanip>
+#include <cstring>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <map>
+
+#include "AntEstimators.h"
+#include "AntLanes.h"
+#include "AntMarkovSolver.h"
+#include "AntWalker.h"
+#include "RandomGenerators.h"
+#include "RunStatistics.h"
+#include "StepHistogram.h"
+#include "ThreadPlacement.h"
+#include "WorkScheduler.h"
 
+// Protects the totals merged by the adaptive mode
 std::mutex mtxStatsWrite;
-long double totalRuns = 0;
-long double totalSteps = 0;
+// Totals of the runs, merged by the adaptive mode or after the join
+AntRunTotals totalRuns = { 0, 0, 0 };
+// Set when the adaptive mode has reached its tolerance
+std::atomic<bool> toleranceReached(false);
+// Next batch of runs of the adaptive mode to hand out
+std::atomic<unsigned long long> nextAdaptiveBatch(0);
+// Histogram of the steps of the runs, merged like the totals
+StepHistogram totalHistogram;
+// Totals of the estimator runs, merged by the adaptive mode with an estimator
+EstimatorTotals totalEstimatorRuns;
+
+/*
+* Struct to hold the result of a batch of the adaptive mode
+*/
+struct AdaptiveBatch
+{
+    AntRunTotals totals;
+    EstimatorTotals estimatorTotals;
+    StepHistogram histogram;
+};
+
+// Batches of the adaptive mode done before the ones still running, merged in order once those are done
+std::map<unsigned long long, AdaptiveBatch> pendingBatches;
+// Number of batches of the adaptive mode merged into the totals
+unsigned long long mergedBatches = 0;
+
+// Runs needed before the confidence interval is trusted
+const unsigned long minAdaptiveRuns = 10000;
+// Max runs of the adaptive mode, it stops there even if the tolerance is not reached
+const double maxAdaptiveRuns = 1e11;
+// Runs of every thread count of the scaling report
+const unsigned long scalingRuns = 2000000;
+
+/*
+* Struct to hold the totals of a thread, alone on its cache line so the
+* threads never write to the same line
+*/
+struct alignas(cacheLineSize) ThreadTotals
+{
+    AntRunTotals totals;
+    StepHistogram histogram;
+
+    ThreadTotals()
+    {
+        this->totals.runs = 0;
+        this->totals.steps = 0;
+        this->totals.squaredSteps = 0;
+    }
+};
+
+/*
+* Struct to hold the estimator totals of a thread, alone on its cache lines
+*/
+struct alignas(cacheLineSize) ThreadEstimatorTotals
+{
+    EstimatorTotals totals;
+    StepHistogram histogram;
+};
 
 /*
 * Function to find steps taken for ant to move all seeds
 * from the bottom row to the top row
-* 
-* @param numRuns -> numbers of times the whole problem should be run
+* Runs the chunks given by the scheduler till all the runs are done
+*
+* @param kernel kernel of the grid to walk
+* @param scheduler scheduler handing out the chunks of runs
+* @param thread index of this thread in the scheduler
+* @param seed seed of the simulation, the random stream of a run only depends on it and the run index
+* @param placement cpu topology to pin the thread with
+* @param pinning way to pin the thread
+* @param threadTotals totals of this thread, added up by the main thread after the join
 */
-void antTravelGird(const unsigned long numRuns)
+void antTravelGird(const AntGridKernel* kernel, WorkStealingScheduler& scheduler, const unsigned int thread,
+    const std::uint64_t seed, const ThreadPlacement& placement, const threadPinning pinning,
+    ThreadTotals& threadTotals)
 {
-    // creating random number generator per thread
-    std::random_device rd;
-    std::default_random_engine randGenerator{rd()};
-    // number to direction -> 1=>left, 2=>up, 3=>right, 4=>down
-    std::uniform_int_distribution<int> randDistribution(1, 4);
+    placement.pinThread(thread, pinning);
+    // Totals are filled on the stack of the pinned thread, so they are on its NUMA node, and copied out once
+    ThreadTotals localTotals;
 
-    // Numbers of steps the ant takes in this thread
-    unsigned long threadAntSteps = 0;
-    // Number of times the problem is run in this thread
-    unsigned long threadNumRuns = 0;
+    unsigned long long firstRun = 0;
+    unsigned long chunkRuns = 0;
+    while (scheduler.nextChunk(thread, firstRun, chunkRuns))
+    {
+        // Ants are walked antLaneCount at a time
+        addRunTotals(localTotals.totals, kernel->walkRuns(seed, firstRun, chunkRuns, localTotals.histogram));
+    }
+    threadTotals = localTotals;
+}
 
-    while (threadNumRuns <= numRuns)
+/*
+* Function to run the chunks given by the scheduler with a variance reduction estimator
+*
+* @param kernel kernel of the grid to walk
+* @param estimator estimator to run
+* @param constants exact values of the grid used by the estimator
+* @param scheduler scheduler handing out the chunks of runs
+* @param thread index of this thread in the scheduler
+* @param seed seed of the simulation
+* @param placement cpu topology to pin the thread with
+* @param pinning way to pin the thread
+* @param threadTotals totals of this thread, added up by the main thread after the join
+*/
+void antTravelEstimator(const AntGridKernel* kernel, const antEstimator estimator,
+    const EstimatorConstants& constants, WorkStealingScheduler& scheduler, const unsigned int thread,
+    const std::uint64_t seed, const ThreadPlacement& placement, const threadPinning pinning,
+    ThreadEstimatorTotals& threadTotals)
+{
+    placement.pinThread(thread, pinning);
+    EstimatorTotals localTotals(constants.width);
+    StepHistogram localHistogram;
+
+    unsigned long long firstRun = 0;
+    unsigned long chunkRuns = 0;
+    while (scheduler.nextChunk(thread, firstRun, chunkRuns))
     {
-        // Starting point of the ant
-        int antX = 2, antY = 2;
-        // Tracker to check the number of seeds placed in the top row
-        int seedsPlaced = 0;
+        kernel->walkEstimatorRuns(estimator, constants, seed, firstRun, chunkRuns, localTotals, localHistogram);
+    }
+    threadTotals.totals = localTotals;
+    threadTotals.histogram = localHistogram;
+}
 
-        // Array to denote the seeds at all the cells in the bottom row
-        std::array<bool, 5> bottomRowSeeds{ {true, true, true, true, true} };
-        // Array to denote the seeds at all the cells in the top row
-        std::array<bool, 5> topRowSeeds{ {false, false, false, false, false} };
+/*
+* Function to turn the estimate of an estimator into run statistics
+* The sum of squared deviations is the one of runs with the variance of the estimator,
+* so the confidence interval is the one of the estimator
+*
+* @param estimate estimate of the estimator
+* Return statistics of the estimate
+*/
+RunStatistics createEstimatorStatistics(const EstimatorResult& estimate)
+{
+    RunStatistics statistics;
+    statistics.count = estimate.runs;
+    statistics.mean = estimate.mean;
+    statistics.m2 = estimate.runs > 1 ? estimate.variance * (estimate.runs - 1) : 0;
+    return statistics;
+}
 
-        // Flag to denote whether the ant is carrying a seed
-        bool antHasSeed{ false };
+/*
+* Function to run the problem in batches till the mean is known to the tolerance
+* Batch k is the runs k * batchRuns to (k + 1) * batchRuns - 1. The batches are
+* merged into the totals in order and the tolerance is checked after each one,
+* so the runs used only depend on the seed and not on the threads. The thread
+* which finds the confidence half width below the tolerance stops all the threads
+* With an estimator the half width is the one of the estimator, so an estimator
+* with less variance stops after fewer runs
+*
+* @param kernel kernel of the grid to walk
+* @param estimator estimator to run
+* @param constants exact values of the grid used by the estimator
+* @param tolerance half width of the 95% confidence interval to reach
+* @param batchRuns number of runs per batch
+* @param seed seed of the simulation
+* @param thread index of this thread
+* @param placement cpu topology to pin the thread with
+* @param pinning way to pin the thread
+*/
+void antTravelAdaptive(const AntGridKernel* kernel, const antEstimator estimator,
+    const EstimatorConstants& constants, const double tolerance, const unsigned long batchRuns,
+    const std::uint64_t seed, const unsigned int thread, const ThreadPlacement& placement,
+    const threadPinning pinning)
+{
+    placement.pinThread(thread, pinning);
+    AdaptiveBatch batchResult;
 
-        // Loop to move the ant till all the seeds have been placed
-        while (seedsPlaced != 5)
+    while (not toleranceReached)
+    {
+        unsigned long long batch = nextAdaptiveBatch++;
+        batchResult.histogram.clear();
+        if (estimator == plainRuns)
+        {
+            batchResult.totals = kernel->walkRuns(seed, batch * batchRuns, batchRuns, batchResult.histogram);
+        }
+        else
         {
-            // Flag to check if the ant has made a valid move
-            bool antMoved = false;
+            batchResult.estimatorTotals = EstimatorTotals(constants.width);
+            kernel->walkEstimatorRuns(estimator, constants, seed, batch * batchRuns, batchRuns,
+                batchResult.estimatorTotals, batchResult.histogram);
+        }
 
-            // Loop to try to move the ant in different directions
-            while (antMoved == false)
+        std::lock_guard<std::mutex> statsLock(mtxStatsWrite);
+        pendingBatches[batch] = batchResult;
+        // Merge the batches which are next in order
+        std::map<unsigned long long, AdaptiveBatch>::iterator next = pendingBatches.begin();
+        while (not toleranceReached && next != pendingBatches.end() && next->first == mergedBatches)
+        {
+            totalHistogram.add(next->second.histogram);
+            RunStatistics statistics;
+            if (estimator == plainRuns)
             {
-                // Direction the ant attempts to move
-                int direction = randDistribution(randGenerator);
-
-                // Check if direction is valid
-                if (
-                    // if in first column => cannot go left
-                    (antX == 0 && direction == 1) ||
-                    // if in last column => cannot go  right
-                    (antX == 4 && direction == 3) ||
-                    // if in the bottom row => cannot go down
-                    (antY == 0 && direction == 4) ||
-                    // if in the top row => cannot go up
-                    (antY == 4 && direction == 2))
-                {
-                    continue;
-                }
-
-                // Valid direction found => move ant
-                switch (direction)
-                {
-                case 1:
-                    // direction => left
-                    --antX;
-                    break;
-                case 2:
-                    // direction => up
-                    ++antY;
-                    break;
-                case 3:
-                    // direction => right
-                    ++antX;
-                    break;
-                case 4:
-                    // direction => down
-                    --antY;
-                    break;
-                default:
-                    break;
-                }
-                antMoved = true;
+                addRunTotals(totalRuns, next->second.totals);
+                statistics = RunStatistics::fromSums((double)totalRuns.runs, (double)totalRuns.steps,
+                    (double)totalRuns.squaredSteps);
             }
-            // The move loop ensures that the ant can only move in valid directions
-
-            // Check if ant in bottom row
-            if (antY == 0)
+            else
             {
-                // Check if:
-                // 1. Ant carrying seed?
-                // 2. X location has a seed
-                if (antHasSeed == false && bottomRowSeeds[antX] == true)
-                {
-                    // Ant picks up the seed
-                    antHasSeed = true;
-                    // Removes the seed from the grid
-                    bottomRowSeeds[antX] = false;
-                }
+                totalEstimatorRuns.add(next->second.estimatorTotals);
+                statistics = createEstimatorStatistics(summarizeEstimator(estimator, constants, totalEstimatorRuns));
             }
-            // Check if ant in top row
-            else if (antY == 4)
-            {
-                // check if:
-                // 1. Ant carring seed?
-                // 2. X location does not have seed
-                if (antHasSeed == true && topRowSeeds[antX] == false)
-                {
-                    // Ant keeps the seed in cell
-                    antHasSeed = false;
-                    // Adds the seed to the grid
-                    topRowSeeds[antX] = true;
-                    // Increments the top seeds placed tracker
-                    ++seedsPlaced;
-                }
+            pendingBatches.erase(next++);
+            ++mergedBatches;
 
+            if ((statistics.count >= minAdaptiveRuns && statistics.halfWidth() <= tolerance) ||
+                statistics.count >= maxAdaptiveRuns)
+            {
+                toleranceReached = true;
             }
-            // Increment the number of steps the ant has moved for current thread
-            ++threadAntSteps;
-        }
-        // Increment the number of times problem run for this thread
-        ++threadNumRuns;
-    }
-    // Use mutex locks to protect the write to the total stats variables
-    mtxStatsWrite.lock();
-    // Update the top level total statistics
-    totalRuns += threadNumRuns;
-    totalSteps += threadAntSteps;
-    // Release the lock
-    mtxStatsWrite.unlock();
+        }
+    }
+}
+
+/*
+* Function to check whether the input argument is a number,
+* if so, then set the number through reference
+* else, return false
+*
+* @param charsToCheck char array to verify
+* @param inNumber reference to original variable to set
+* Returns: bool if input is a number
+*/
+bool convertToNumber(const char* charsToCheck, unsigned long& inNumber)
+{
+    // check to see if the char array is a positive integer
+    try
+    {
+        bool check = strlen(charsToCheck) > 0 && std::all_of(charsToCheck, charsToCheck + strlen(charsToCheck),
+            [](char c) { return ::isdigit(c); });
+        if (check)
+        {
+            inNumber = std::stoul(std::string(charsToCheck));
+            return true;
+        }
+        return false;
+    }
+    catch (const std::exception&)
+    {
+        // return invalid if exception occured
+        return false;
+    }
+}
+
+/*
+* Function to check whether the input argument is a positive decimal number,
+* if so, then set the number through reference
+* else, return false
+*
+* @param charsToCheck char array to verify
+* @param inNumber reference to original variable to set
+* Returns: bool if input is a positive number
+*/
+bool convertToNumber(const char* charsToCheck, double& inNumber)
+{
+    char* end = NULL;
+    double number = strtod(charsToCheck, &end);
+    if (end == charsToCheck || *end != '\0' || not (number > 0) || std::isinf(number))
+    {
+        return false;
+    }
+    inNumber = number;
+    return true;
+}
+
+/*
+* Function to solve the problem exactly and write the result
+*
+* @param gridWidth width of the grid
+* @param gridHeight height of the grid
+* @param ofOutFile stream to write the result to
+*/
+void writeExactSolution(int gridWidth, int gridHeight, std::ofstream& ofOutFile)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    AntMarkovSolver solver(gridWidth, gridHeight, gridWidth / 2, gridHeight / 2);
+    double expectedSteps = solver.solveExpectedSteps();
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+    ofOutFile << "Grid: " << gridWidth << " x " << gridHeight << "\n\n";
+    ofOutFile << std::fixed << std::setprecision(12) << "Expected number of steps (exact): " << expectedSteps << "\n\n";
+    ofOutFile << "Phases solved: " << solver.getPhaseCount() << ", phase matrices factorized: "
+        << solver.getFactorizationCount() << "\n\n";
+    ofOutFile << std::setprecision(3) << "Solve time: " << milliseconds << " ms";
+}
+
+/*
+* Function to do a fixed number of runs with plain Monte Carlo
+* Runs are handed out in chunks of batchRuns, threads which run out of chunks steal from the others
+*
+* @param kernel kernel of the grid to walk
+* @param seed seed of the simulation
+* @param numRuns number of runs to do
+* @param batchRuns number of runs per chunk
+* @param numThreads number of threads
+* @param placement cpu topology to pin the threads with
+* @param pinning way to pin the threads
+* @param totals reference to add the totals of the runs to
+* @param histogram reference to add the steps of the runs to
+* Return wall time of the runs in seconds
+*/
+double runPlainRuns(const AntGridKernel* kernel, std::uint64_t seed, unsigned long numRuns, unsigned long batchRuns,
+    unsigned int numThreads, const ThreadPlacement& placement, threadPinning pinning, AntRunTotals& totals,
+    StepHistogram& histogram)
+{
+    WorkStealingScheduler scheduler(numRuns, batchRuns, numThreads);
+    CacheAlignedArray<ThreadTotals> threadTotals(numThreads);
+
+    auto startTime = std::chrono::steady_clock::now();
+    std::vector<std::thread> threadVector;
+    threadVector.reserve(numThreads);
+    for (unsigned int i = 0; i < numThreads; ++i)
+    {
+        threadVector.push_back(std::thread(antTravelGird, kernel, std::ref(scheduler), i, seed, std::cref(placement),
+            pinning, std::ref(threadTotals[i])));
+    }
+    for (unsigned int i = 0; i < numThreads; ++i)
+    {
+        threadVector[i].join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    // All the threads are done, their totals are merged without locks
+    // The totals are integers, so the sum is the same however the runs were shared out
+    for (unsigned int i = 0; i < numThreads; ++i)
+    {
+        addRunTotals(totals, threadTotals[i].totals);
+        histogram.add(threadTotals[i].histogram);
+    }
+    return seconds;
+}
+
+/*
+* Function to run the same runs on 1 to maxThreads threads and write how they scale
+*
+* @param kernel kernel of the grid to walk
+* @param seed seed of the simulation
+* @param batchRuns number of runs per chunk
+* @param maxThreads max number of threads
+* @param placement cpu topology to pin the threads with
+* @param pinning way to pin the threads
+* @param ofOutFile stream to write the report to
+*/
+void writeScalingReport(const AntGridKernel* kernel, std::uint64_t seed, unsigned long batchRuns,
+    unsigned int maxThreads, const ThreadPlacement& placement, threadPinning pinning, std::ofstream& ofOutFile)
+{
+    ofOutFile << "Scaling of " << scalingRuns << " runs on a " << kernel->width << " x " << kernel->height
+        << " grid, " << placement.describe() << "\n\n";
+    ofOutFile << "threads  runs/s        speedup  efficiency  threads on SMT siblings  mean steps";
+
+    double singleThreadRate = 0;
+    for (unsigned int numThreads = 1; numThreads <= maxThreads; ++numThreads)
+    {
+        AntRunTotals totals = { 0, 0, 0 };
+        StepHistogram histogram;
+        double seconds = runPlainRuns(kernel, seed, scalingRuns, batchRuns, numThreads, placement, pinning,
+            totals, histogram);
+        double rate = totals.runs / seconds;
+        singleThreadRate = numThreads == 1 ? rate : singleThreadRate;
+        double speedup = rate / singleThreadRate;
+
+        ofOutFile << "\n" << std::left << std::setw(9) << numThreads << std::fixed << std::setprecision(0)
+            << std::setw(14) << rate << std::setprecision(3) << std::setw(9) << speedup << std::setw(12)
+            << speedup / numThreads << std::setw(25) << placement.getSmtThreadCount(numThreads)
+            << std::setprecision(6) << (double)totals.steps / totals.runs;
+    }
+}
+
+/*
+* Function to write the quantiles and the histogram of the steps
+*
+* @param histogram histogram of the steps of all the runs
+* @param ofOutFile stream to write to
+*/
+void writeStepDistribution(const StepHistogram& histogram, std::ofstream& ofOutFile)
+{
+    ofOutFile << "\n\nSteps quantiles (upper bound of the bucket): p50 " << histogram.getQuantile(0.5)
+        << ", p90 " << histogram.getQuantile(0.9) << ", p99 " << histogram.getQuantile(0.99)
+        << ", p99.9 " << histogram.getQuantile(0.999) << "\n\n";
+    ofOutFile << "Histogram of the steps (lowest - highest: runs):";
+    for (int bucket = 0; bucket < histogramSize; ++bucket)
+    {
+        if (histogram.getCount(bucket) > 0)
+        {
+            ofOutFile << "\n" << StepHistogram::getLowestValue(bucket) << " - "
+                << StepHistogram::getHighestValue(bucket) << ": " << histogram.getCount(bucket);
+        }
+    }
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+    // Options of the exact solver
+    bool exactMode = false;
+    unsigned long gridWidth = gridSize, gridHeight = gridSize;
+    // Options of the adaptive mode, 0 tolerance for the fixed number of runs
+    double tolerance = 0;
+    unsigned long batchRuns = 10000;
+    // Seed of the Monte Carlo modes
+    unsigned long seed = 0;
+    bool seedGiven = false;
+    antEstimator estimator = plainRuns;
+    // Threads, 0 for all the cpus, how they are pinned and the scaling report
+    unsigned long threadCount = 0;
+    threadPinning pinning = pinNone;
+    bool scalingMode = false;
+    bool validArgs = true;
+    for (int i = 1; i < argc && validArgs; ++i)
+    {
+        if (strcmp(argv[i], "--exact") == 0)
+        {
+            exactMode = true;
+        }
+        else if (strcmp(argv[i], "--grid") == 0 && i + 2 < argc)
+        {
+            validArgs = convertToNumber(argv[i + 1], gridWidth) && convertToNumber(argv[i + 2], gridHeight) &&
+                gridWidth >= 1 && gridWidth <= 1000 && gridHeight >= 2 && gridHeight <= 1000;
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc)
+        {
+            validArgs = convertToNumber(argv[++i], tolerance);
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+        {
+            validArgs = convertToNumber(argv[++i], batchRuns) && batchRuns > 0;
+        }
+        else if (strcmp(argv[i], "--estimator") == 0 && i + 1 < argc)
+        {
+            validArgs = findEstimator(argv[++i], estimator);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            validArgs = convertToNumber(argv[++i], threadCount) && threadCount >= 1 && threadCount <= 4096;
+        }
+        else if (strcmp(argv[i], "--pin") == 0 && i + 1 < argc)
+        {
+            validArgs = ThreadPlacement::findPinning(argv[++i], pinning);
+        }
+        else if (strcmp(argv[i], "--scaling") == 0)
+        {
+            scalingMode = true;
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            validArgs = convertToNumber(argv[++i], seed);
+            seedGiven = true;
+        }
+        else
+        {
+            validArgs = false;
+        }
+    }
+    // Exact solver keeps a row in 32 bit masks, Monte Carlo modes need a kernel compiled for the grid size
+    const AntGridKernel* kernel = findGridKernel((int)gridWidth, (int)gridHeight);
+    validArgs = validArgs && (exactMode ? gridWidth <= (unsigned long)maxSolverWidth : kernel != NULL);
+    // The scaling report only runs plain Monte Carlo
+    validArgs = validArgs && (not scalingMode || (estimator == plainRuns && tolerance == 0 && not exactMode));
+
+    if (not validArgs || exactMode)
+    {
+        std::ofstream ofOutFile;
+        ofOutFile.open("ProblemOne.txt", std::ios::trunc);
+        if (not ofOutFile.is_open())
+        {
+            // If unable to open output file => print error
+            std::cerr << "Unable to open output file: ProblemOne.txt" << std::endl;
+            return 1;
+        }
+        if (not validArgs)
+        {
+            ofOutFile << "Invalid inputs";
+            ofOutFile.close();
+            return 1;
+        }
+        writeExactSolution((int)gridWidth, (int)gridHeight, ofOutFile);
+        ofOutFile.close();
+        return 0;
+    }
+
+    if (not seedGiven)
+    {
+        std::random_device rd;
+        seed = (unsigned long)(((std::uint64_t)rd() << 32) | rd());
+    }
+
     // Number of total runs required
     unsigned long totalRunsRequired = 10000000;
 
+    // Cpus, cores and NUMA nodes the threads are placed on
+    ThreadPlacement placement;
     // Get the number of threads
-    unsigned long numThreads(std::thread::hardware_concurrency());
+    unsigned int numThreads = threadCount > 0 ? (unsigned int)threadCount : placement.getCpuCount();
+
+    if (scalingMode)
+    {
+        std::ofstream ofOutFile;
+        ofOutFile.open("ProblemOne.txt", std::ios::trunc);
+        if (not ofOutFile.is_open())
+        {
+            // If unable to open output file => print error
+            std::cerr << "Unable to open output file: ProblemOne.txt" << std::endl;
+            return 1;
+        }
+        writeScalingReport(kernel, seed, batchRuns, numThreads, placement, pinning, ofOutFile);
+        ofOutFile.close();
+        return 0;
+    }
+
+    // Antithetic runs come in pairs, which must not be split between chunks
+    if (estimator == antitheticRuns)
+    {
+        batchRuns += batchRuns % 2;
+    }
 
-    // adding 1 to the numThreads to account for the main thread
-    unsigned long runsPerThread = ceil(totalRunsRequired / numThreads);
+    // Runs are handed out in chunks of batchRuns, threads which run out of chunks steal from the others
+    WorkStealingScheduler scheduler(totalRunsRequired, batchRuns, numThreads);
 
-    // create vector of threads
-    std::vector<std::thread> threadVector;
-    threadVector.reserve(numThreads);
-;
-    // spawn the thread with function
-    for (unsigned long i = 0; i < numThreads; ++i)
+    // Exact values used by the estimator
+    EstimatorConstants estimatorConstants;
+    CacheAlignedArray<ThreadEstimatorTotals> threadEstimatorTotals(
+        estimator == plainRuns || tolerance > 0 ? 0 : numThreads);
+    if (estimator != plainRuns)
     {
-        threadVector.push_back(std::thread(antTravelGird, runsPerThread));
+        estimatorConstants = createEstimatorConstants((int)gridWidth, (int)gridHeight);
+        totalEstimatorRuns = EstimatorTotals((int)gridWidth);
     }
 
-    // Join the threads to the main thread
-    for (unsigned long i = 0; i < numThreads; ++i)
+    if (tolerance == 0 && estimator == plainRuns)
     {
-        threadVector[i].join();
+        runPlainRuns(kernel, seed, totalRunsRequired, batchRuns, numThreads, placement, pinning, totalRuns,
+            totalHistogram);
+    }
+    else
+    {
+        // create vector of threads
+        std::vector<std::thread> threadVector;
+        threadVector.reserve(numThreads);
+
+        // spawn the thread with function
+        for (unsigned int i = 0; i < numThreads; ++i)
+        {
+            if (tolerance > 0)
+            {
+                threadVector.push_back(std::thread(antTravelAdaptive, kernel, estimator,
+                    std::cref(estimatorConstants), tolerance, batchRuns, (std::uint64_t)seed, i, std::cref(placement),
+                    pinning));
+            }
+            else
+            {
+                threadVector.push_back(std::thread(antTravelEstimator, kernel, estimator,
+                    std::cref(estimatorConstants), std::ref(scheduler), i, (std::uint64_t)seed, std::cref(placement),
+                    pinning, std::ref(threadEstimatorTotals[i])));
+            }
+        }
+
+        // Join the threads to the main thread
+        for (unsigned int i = 0; i < numThreads; ++i)
+        {
+            threadVector[i].join();
+        }
+    }
+    RunStatistics totalStatistics = RunStatistics::fromSums((double)totalRuns.runs,
+        (double)totalRuns.steps, (double)totalRuns.squaredSteps);
+
+    EstimatorResult estimate = { 0, 0, 0, 0, 0 };
+    if (estimator != plainRuns)
+    {
+        // The adaptive mode merged its batches already, the fixed runs are merged from the threads
+        EstimatorTotals estimatorTotals = totalEstimatorRuns;
+        for (unsigned int i = 0; i < threadEstimatorTotals.size(); ++i)
+        {
+            estimatorTotals.add(threadEstimatorTotals[i].totals);
+            totalHistogram.add(threadEstimatorTotals[i].histogram);
+        }
+        estimate = summarizeEstimator(estimator, estimatorConstants, estimatorTotals);
+        totalStatistics = createEstimatorStatistics(estimate);
     }
 
     // Open output stream to write data into out file
@@ -189,9 +639,36 @@ int main()
         return 1;
     }
 
-    ofOutFile << "Number of threads created: " << (unsigned long)numThreads << "\n\n";
-    ofOutFile << std::fixed << std::setprecision(6) << "Expected number of steps: " << (double)(totalSteps / totalRuns) << "\n\n";
-    ofOutFile << "Total number of runs needed for solution convergence: " << (unsigned long)totalRuns;
+    ofOutFile << "Number of threads created: " << numThreads << "\n\n";
+    ofOutFile << "Grid: " << gridWidth << " x " << gridHeight << "\n\n";
+    ofOutFile << "Seed: " << seed << "\n\n";
+    ofOutFile << std::fixed << std::setprecision(6) << "Expected number of steps: " << totalStatistics.mean << "\n\n";
+    ofOutFile << "Standard error of the mean: " << totalStatistics.standardError()
+        << " (95% confidence half width: " << totalStatistics.halfWidth() << ")\n\n";
+    if (estimator != plainRuns)
+    {
+        ofOutFile << "Estimator: " << getEstimatorName(estimator) << "\n\n";
+        ofOutFile << "Variance per run: " << estimate.variance << " (plain Monte Carlo: " << estimate.plainVariance
+            << ")\n\n";
+        ofOutFile << "Variance reduction factor: " << estimate.reductionFactor
+            << " (plain Monte Carlo needs that many times the runs for the same confidence interval)\n\n";
+        if (estimate.reductionFactor < 1)
+        {
+            // Antithetic pairs do this on the ant grid, the complemented walk is not anti correlated
+            ofOutFile << "Warning: the " << getEstimatorName(estimator) << " estimator has more variance than "
+                << "plain Monte Carlo here, plain runs reach the same confidence interval with fewer runs\n\n";
+        }
+    }
+    if (tolerance > 0)
+    {
+        ofOutFile << "Tolerance: " << tolerance << (totalStatistics.halfWidth() <= tolerance ? " (reached)" :
+            " (not reached, stopped at the max number of runs)") << "\n\n";
+    }
+    ofOutFile << "Total number of runs needed for solution convergence: " << (unsigned long)totalStatistics.count;
+    if (totalHistogram.getTotalCount() > 0)
+    {
+        writeStepDistribution(totalHistogram, ofOutFile);
+    }
     ofOutFile.close();
 
     return 0;
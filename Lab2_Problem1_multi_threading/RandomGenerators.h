@@ -0,0 +1,174 @@
+/*
+* Header file for the random number generators of the ant simulation
+*
+* Every run has its own random stream which only depends on the seed and
+* the index of the run: the counter based Philox4x32-10 generator (Salmon
+* et al., "Parallel Random Numbers: As Easy as 1, 2, 3") maps (seed, run)
+* to the 128 bit state of a xoshiro128** generator (Blackman and Vigna),
+* which then draws the moves of the run. The runs can be done by any
+* thread in any order and the result stays the same for the same seed.
+*/
+
+#ifndef __RANDOMGENERATORS__HEADER__
+#define __RANDOMGENERATORS__HEADER__
+
+#include <cstdint>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+/*
+* Function to map a 32 bit random number to [0, bound) without a division
+* Uses the random number times the bound (Lemire), the bias is below bound / 2^32
+* @param random 32 bit random number
+* @param bound number of values to map to
+* Return number in [0, bound)
+*/
+inline std::uint32_t boundedRandom(std::uint32_t random, std::uint32_t bound)
+{
+    return (std::uint32_t)(((std::uint64_t)random * bound) >> 32);
+}
+
+/*
+* Function to compute the Philox4x32-10 block of a counter
+* @param counter 128 bit counter as 4 words
+* @param key 64 bit key as 2 words
+* @param out array to set the 4 random words
+*/
+inline void philox4x32(const std::uint32_t counter[4], const std::uint32_t key[2], std::uint32_t out[4])
+{
+    std::uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    std::uint32_t k0 = key[0], k1 = key[1];
+    for (int round = 0; round < 10; ++round)
+    {
+        std::uint64_t product0 = (std::uint64_t)0xD2511F53u * c0;
+        std::uint64_t product1 = (std::uint64_t)0xCD9E8D57u * c2;
+        c0 = (std::uint32_t)(product1 >> 32) ^ c1 ^ k0;
+        c1 = (std::uint32_t)product1;
+        c2 = (std::uint32_t)(product0 >> 32) ^ c3 ^ k1;
+        c3 = (std::uint32_t)product0;
+        // Key schedule is a Weyl sequence
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+/*
+* Function to get the generator state of a run
+* @param seed seed of the simulation, the Philox key
+* @param run index of the run, the Philox counter
+* @param state array to set the 128 bit state of the generator of the run
+*/
+inline void runStreamState(std::uint64_t seed, std::uint64_t run, std::uint32_t state[4])
+{
+    const std::uint32_t counter[4] = { (std::uint32_t)run, (std::uint32_t)(run >> 32), 0, 0 };
+    const std::uint32_t key[2] = { (std::uint32_t)seed, (std::uint32_t)(seed >> 32) };
+    philox4x32(counter, key, state);
+    // xoshiro can not start from the all zero state
+    if ((state[0] | state[1] | state[2] | state[3]) == 0)
+    {
+        state[0] = 1;
+    }
+}
+
+/*
+* Class for the xoshiro128** generator of a run
+* Has the interface of a std uniform random bit generator
+*/
+class Xoshiro128StarStar
+{
+    std::uint32_t state[4];
+
+    /*
+    * Function to rotate the bits of a number to the left
+    */
+    static std::uint32_t rotateLeft(std::uint32_t x, int k)
+    {
+        return (x << k) | (x >> (32 - k));
+    }
+
+public:
+    typedef std::uint32_t result_type;
+
+    /*
+    * Constructor to create the generator of a run
+    * @param seed seed of the simulation
+    * @param run index of the run
+    */
+    Xoshiro128StarStar(std::uint64_t seed, std::uint64_t run)
+    {
+        runStreamState(seed, run, this->state);
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~(result_type)0; }
+
+    /*
+    * Function to get the next random number
+    * Return 32 random bits
+    */
+    result_type operator()()
+    {
+        std::uint32_t result = rotateLeft(this->state[1] * 5, 7) * 9;
+        std::uint32_t shifted = this->state[1] << 9;
+
+        this->state[2] ^= this->state[0];
+        this->state[3] ^= this->state[1];
+        this->state[1] ^= this->state[2];
+        this->state[0] ^= this->state[3];
+        this->state[2] ^= shifted;
+        this->state[3] = rotateLeft(this->state[3], 11);
+
+        return result;
+    }
+};
+
+#ifdef __AVX2__
+/*
+* Class for 8 xoshiro128** generators in the 32 bit lanes of AVX2 registers
+* Lane i gives the same numbers as a Xoshiro128StarStar with the same state,
+* the multiplications by 5 and 9 are done as shift and add
+*/
+class Xoshiro128StarStarX8
+{
+    /*
+    * Function to rotate the bits of every lane to the left
+    */
+    static __m256i rotateLeft(__m256i x, int k)
+    {
+        return _mm256_or_si256(_mm256_slli_epi32(x, k), _mm256_srli_epi32(x, 32 - k));
+    }
+
+public:
+    // Word i of the state of the 8 generators, set per lane when a lane starts a run
+    __m256i state[4];
+
+    /*
+    * Function to get the next random numbers of the 8 generators
+    * Return 8 x 32 random bits
+    */
+    __m256i operator()()
+    {
+        __m256i timesFive = _mm256_add_epi32(this->state[1], _mm256_slli_epi32(this->state[1], 2));
+        __m256i rotated = rotateLeft(timesFive, 7);
+        __m256i result = _mm256_add_epi32(rotated, _mm256_slli_epi32(rotated, 3));
+        __m256i shifted = _mm256_slli_epi32(this->state[1], 9);
+
+        this->state[2] = _mm256_xor_si256(this->state[2], this->state[0]);
+        this->state[3] = _mm256_xor_si256(this->state[3], this->state[1]);
+        this->state[1] = _mm256_xor_si256(this->state[1], this->state[2]);
+        this->state[0] = _mm256_xor_si256(this->state[0], this->state[3]);
+        this->state[2] = _mm256_xor_si256(this->state[2], shifted);
+        this->state[3] = rotateLeft(this->state[3], 11);
+
+        return result;
+    }
+};
+#endif // __AVX2__
+
+#endif // !__RANDOMGENERATORS__HEADER__
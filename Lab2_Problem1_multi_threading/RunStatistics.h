@@ -0,0 +1,78 @@
+/*
+* Header file for the running statistics of the step counts
+*
+* The runs report the sum and the sum of squares of their steps as
+* integers, which are turned into (count, mean, M2).
+*/
+
+#ifndef __RUNSTATISTICS__HEADER__
+#define __RUNSTATISTICS__HEADER__
+
+#include <algorithm>
+#include <cmath>
+
+// z value of the 95% two sided confidence interval
+const double confidenceZ = 1.959963984540054;
+
+/*
+* Struct to hold the count, mean and sum of squared deviations of the steps
+*/
+struct RunStatistics
+{
+    double count;   // number of runs
+    double mean;    // mean steps of the runs
+    double m2;      // sum of the squared deviations from the mean
+
+    /*
+    * Constructor to create empty statistics
+    */
+    RunStatistics() : count(0), mean(0), m2(0) {}
+
+    /*
+    * Function to create the statistics of a batch from its sums
+    * @param runs number of runs of the batch
+    * @param sum sum of the steps of the runs
+    * @param sumSquares sum of the squared steps of the runs
+    * Return statistics of the batch
+    */
+    static RunStatistics fromSums(double runs, double sum, double sumSquares)
+    {
+        RunStatistics batch;
+        if (runs > 0)
+        {
+            batch.count = runs;
+            batch.mean = sum / runs;
+            batch.m2 = std::max(0.0, sumSquares - sum * batch.mean);
+        }
+        return batch;
+    }
+
+    /*
+    * Function to get the sample variance of the steps
+    * Return variance, 0 for less than 2 runs
+    */
+    double variance() const
+    {
+        return this->count > 1 ? this->m2 / (this->count - 1) : 0;
+    }
+
+    /*
+    * Function to get the standard error of the mean
+    * Return standard deviation / sqrt(runs)
+    */
+    double standardError() const
+    {
+        return this->count > 0 ? std::sqrt(variance() / this->count) : 0;
+    }
+
+    /*
+    * Function to get the half width of the 95% confidence interval of the mean
+    * Return z * standard error
+    */
+    double halfWidth() const
+    {
+        return confidenceZ * standardError();
+    }
+};
+
+#endif // !__RUNSTATISTICS__HEADER__
@@ -0,0 +1,186 @@
+/*
+* Header file for the histogram of the step counts
+*
+* Log bucketed like HdrHistogram: values below 2 * histogramHalfCount have
+* a bucket each, above that every power of 2 is cut into histogramHalfCount
+* buckets, so a bucket is never wider than 1 / histogramHalfCount of its
+* values. Any 32 bit step count fits in histogramSize buckets, so the memory
+* is fixed. Every thread fills its own histogram without locks and the
+* histograms are added up once the threads are done.
+*/
+
+#ifndef __STEPHISTOGRAM__HEADER__
+#define __STEPHISTOGRAM__HEADER__
+
+#include <cstddef>
+#include <cstdint>
+
+// Buckets per power of 2, 1.6% precision
+const int histogramHalfCount = 64;
+// Powers of 2 above the exact buckets for 32 bit values: 2^7 to 2^31
+const int histogramPowerCount = 25;
+// Number of buckets
+const int histogramSize = (histogramPowerCount + 2) * histogramHalfCount;
+
+/*
+* Class for the histogram of the steps of the runs
+*/
+class StepHistogram
+{
+    std::uint64_t counts[histogramSize];
+
+    /*
+    * Function to get the index of the highest set bit
+    */
+    static int highestBit(std::uint32_t value)
+    {
+#if defined(__GNUC__)
+        return 31 - __builtin_clz(value | 1);
+#else
+        int bit = 0;
+        while (value >>= 1)
+        {
+            ++bit;
+        }
+        return bit;
+#endif
+    }
+
+public:
+    /*
+    * Constructor to create an empty histogram
+    */
+    StepHistogram()
+    {
+        clear();
+    }
+
+    /*
+    * Function to empty the histogram
+    */
+    void clear()
+    {
+        for (int i = 0; i < histogramSize; ++i)
+        {
+            this->counts[i] = 0;
+        }
+    }
+
+    /*
+    * Function to get the bucket of a value
+    * @param value value to find the bucket of
+    * Return index of the bucket
+    */
+    static int getBucket(std::uint32_t value)
+    {
+        // Values below 2 * histogramHalfCount keep all their bits, larger ones the top 7
+        int shift = highestBit(value) - 6;
+        shift = shift > 0 ? shift : 0;
+        return shift * histogramHalfCount + (int)(value >> shift);
+    }
+
+    /*
+    * Function to get the lowest value of a bucket
+    * @param bucket index of the bucket
+    * Return lowest value which goes in the bucket
+    */
+    static std::uint64_t getLowestValue(int bucket)
+    {
+        int shift = bucket / histogramHalfCount - 1;
+        shift = shift > 0 ? shift : 0;
+        return (std::uint64_t)(bucket - shift * histogramHalfCount) << shift;
+    }
+
+    /*
+    * Function to get the highest value of a bucket
+    * @param bucket index of the bucket
+    * Return highest value which goes in the bucket
+    */
+    static std::uint64_t getHighestValue(int bucket)
+    {
+        return getLowestValue(bucket + 1) - 1;
+    }
+
+    /*
+    * Function to add a run to the histogram
+    * @param steps steps of the run
+    */
+    void record(std::uint32_t steps)
+    {
+        ++this->counts[getBucket(steps)];
+    }
+
+    /*
+    * Function to add the runs of another histogram to this one
+    * @param other histogram to add
+    */
+    void add(const StepHistogram& other)
+    {
+        for (int i = 0; i < histogramSize; ++i)
+        {
+            this->counts[i] += other.counts[i];
+        }
+    }
+
+    /*
+    * Function to add runs to a bucket, used to rebuild a histogram sent as counts
+    * @param bucket index of the bucket
+    * @param count number of runs to add
+    */
+    void addCount(int bucket, std::uint64_t count)
+    {
+        this->counts[bucket] += count;
+    }
+
+    /*
+    * Getter for the number of runs in a bucket
+    * @param bucket index of the bucket
+    * Return number of runs
+    */
+    std::uint64_t getCount(int bucket) const
+    {
+        return this->counts[bucket];
+    }
+
+    /*
+    * Function to get the number of runs in the histogram
+    * Return number of runs
+    */
+    std::uint64_t getTotalCount() const
+    {
+        std::uint64_t total = 0;
+        for (int i = 0; i < histogramSize; ++i)
+        {
+            total += this->counts[i];
+        }
+        return total;
+    }
+
+    /*
+    * Function to get a quantile of the steps
+    * @param quantile fraction of the runs, 0.5 for the median
+    * Return highest value of the bucket holding the quantile, 0 for an empty histogram
+    */
+    std::uint64_t getQuantile(double quantile) const
+    {
+        std::uint64_t total = getTotalCount();
+        if (total == 0)
+        {
+            return 0;
+        }
+        // Rank of the run at the quantile, from 1
+        double rank = quantile * total;
+        std::uint64_t below = 0;
+        for (int i = 0; i < histogramSize; ++i)
+        {
+            below += this->counts[i];
+            if (below > 0 && below >= rank)
+            {
+                return getHighestValue(i);
+            }
+        }
+        return getHighestValue(histogramSize - 1);
+    }
+};
+
+#endif // !__STEPHISTOGRAM__HEADER__
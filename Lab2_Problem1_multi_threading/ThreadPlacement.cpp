@@ -0,0 +1,270 @@
+/*
+* Implementation file for ThreadPlacement.cpp
+*/
+
+#include "ThreadPlacement.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/*
+* Function to read the first line of a sysfs file
+* @param path path of the file
+* @param line reference to set the line
+* Return bool if the file could be read
+*/
+static bool readSysfsLine(const std::string& path, std::string& line)
+{
+    std::ifstream inFile(path.c_str());
+    return inFile.is_open() && std::getline(inFile, line) && not line.empty();
+}
+
+/*
+* Function to read a cpu or node list like "0-3,8,10-11"
+* @param path path of the sysfs file holding the list
+* Return numbers of the list, empty if the file could not be read
+*/
+static std::vector<int> readSysfsList(const std::string& path)
+{
+    std::vector<int> numbers;
+    std::string line;
+    if (not readSysfsLine(path, line))
+    {
+        return numbers;
+    }
+    std::stringstream ssList(line);
+    std::string range;
+    while (std::getline(ssList, range, ','))
+    {
+        char* end = NULL;
+        int first = (int)strtol(range.c_str(), &end, 10);
+        int last = first;
+        if (end != NULL && *end == '-')
+        {
+            last = (int)strtol(end + 1, NULL, 10);
+        }
+        for (int number = first; number <= last; ++number)
+        {
+            numbers.push_back(number);
+        }
+    }
+    return numbers;
+}
+
+/*
+* Function to read a number from a sysfs file
+* @param path path of the file
+* @param fallback value to return if the file could not be read
+* Return number in the file
+*/
+static int readSysfsNumber(const std::string& path, int fallback)
+{
+    std::string line;
+    return readSysfsLine(path, line) ? atoi(line.c_str()) : fallback;
+}
+
+/*
+* Constructor to read the cpu topology
+* Falls back to hardware_concurrency cpus on one node, each its own core, if sysfs can not be read
+*/
+ThreadPlacement::ThreadPlacement() : coreCount(0), nodeCount(1)
+{
+    const std::string cpuPath = "/sys/devices/system/cpu/";
+    const std::string nodePath = "/sys/devices/system/node/";
+
+    std::vector<int> online = readSysfsList(cpuPath + "online");
+#ifdef __linux__
+    // Only the cpus this process may run on, a container or taskset may allow fewer than are online
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+    {
+        std::vector<int> allowedOnline;
+        for (std::size_t i = 0; i < online.size(); ++i)
+        {
+            if (online[i] < CPU_SETSIZE && CPU_ISSET(online[i], &allowed))
+            {
+                allowedOnline.push_back(online[i]);
+            }
+        }
+        online.swap(allowedOnline);
+    }
+#endif
+    if (online.empty())
+    {
+        unsigned int cpuCount = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int cpu = 0; cpu < cpuCount; ++cpu)
+        {
+            CpuPlace place = { (int)cpu, (int)cpu, 0, 0 };
+            this->cpus.push_back(place);
+        }
+        this->coreCount = (int)cpuCount;
+        return;
+    }
+
+    // NUMA node of every cpu, node 0 without NUMA support
+    std::map<int, int> cpuNodes;
+    std::vector<int> nodes = readSysfsList(nodePath + "online");
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+        std::vector<int> nodeCpus = readSysfsList(nodePath + "node" + std::to_string(nodes[i]) + "/cpulist");
+        for (std::size_t j = 0; j < nodeCpus.size(); ++j)
+        {
+            cpuNodes[nodeCpus[j]] = nodes[i];
+        }
+    }
+    this->nodeCount = std::max(1, (int)nodes.size());
+
+    // Cores are numbered in the order they are found, their rank in their node spreads them over the nodes
+    std::map<std::pair<int, int>, int> coreIndexes;
+    std::map<int, int> nodeCoreCounts;
+    std::vector<int> coreRanks;
+    for (std::size_t i = 0; i < online.size(); ++i)
+    {
+        int cpu = online[i];
+        std::string topologyPath = cpuPath + "cpu" + std::to_string(cpu) + "/topology/";
+        int package = readSysfsNumber(topologyPath + "physical_package_id", 0);
+        int coreId = readSysfsNumber(topologyPath + "core_id", cpu);
+        std::vector<int> siblings = readSysfsList(topologyPath + "thread_siblings_list");
+
+        CpuPlace place;
+        place.cpu = cpu;
+        place.node = cpuNodes.count(cpu) ? cpuNodes[cpu] : 0;
+        place.smtRank = (int)(std::find(siblings.begin(), siblings.end(), cpu) - siblings.begin());
+        place.smtRank = place.smtRank < (int)siblings.size() ? place.smtRank : 0;
+
+        std::pair<int, int> coreKey(package, coreId);
+        if (coreIndexes.count(coreKey) == 0)
+        {
+            coreIndexes[coreKey] = (int)coreRanks.size();
+            coreRanks.push_back(nodeCoreCounts[place.node]++);
+        }
+        place.core = coreIndexes[coreKey];
+        this->cpus.push_back(place);
+    }
+    this->coreCount = (int)coreRanks.size();
+
+    // One cpu of every core first, round the nodes, then the SMT siblings
+    std::stable_sort(this->cpus.begin(), this->cpus.end(), [&coreRanks](const CpuPlace& a, const CpuPlace& b)
+        {
+            if (a.smtRank != b.smtRank)
+            {
+                return a.smtRank < b.smtRank;
+            }
+            if (coreRanks[a.core] != coreRanks[b.core])
+            {
+                return coreRanks[a.core] < coreRanks[b.core];
+            }
+            return a.node < b.node;
+        });
+}
+
+/*
+* Function to find a way to pin the threads from its name
+* @param name none, cores or nodes
+* @param pinning reference to set the way to pin the threads
+* Return bool if the name is a way to pin the threads
+*/
+bool ThreadPlacement::findPinning(const char* name, threadPinning& pinning)
+{
+    if (strcmp(name, "none") == 0)
+    {
+        pinning = pinNone;
+    }
+    else if (strcmp(name, "cores") == 0)
+    {
+        pinning = pinCores;
+    }
+    else if (strcmp(name, "nodes") == 0)
+    {
+        pinning = pinNodes;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+/*
+* Function to pin the calling thread
+* @param thread index of the thread, thread i gets the i-th cpu of the placement order
+* @param pinning pin to the cpu, to all the cpus of its node or not at all
+* Return bool if the thread was pinned
+*/
+bool ThreadPlacement::pinThread(unsigned int thread, threadPinning pinning) const
+{
+    if (pinning == pinNone || this->cpus.empty())
+    {
+        return false;
+    }
+#ifdef __linux__
+    const CpuPlace& place = this->cpus[thread % this->cpus.size()];
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (std::size_t i = 0; i < this->cpus.size(); ++i)
+    {
+        if (pinning == pinCores ? this->cpus[i].cpu == place.cpu : this->cpus[i].node == place.node)
+        {
+            CPU_SET(this->cpus[i].cpu, &cpuSet);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#else
+    (void)thread;
+    return false;
+#endif
+}
+
+/*
+* Function to get the number of threads which share a core with another thread
+* @param threadCount number of threads placed
+* Return number of threads on the SMT siblings of cores already used
+*/
+unsigned int ThreadPlacement::getSmtThreadCount(unsigned int threadCount) const
+{
+    unsigned int smtThreads = 0;
+    for (unsigned int i = 0; i < threadCount && i < this->cpus.size(); ++i)
+    {
+        smtThreads += this->cpus[i].smtRank > 0 ? 1 : 0;
+    }
+    return smtThreads;
+}
+
+/*
+* Function to describe the topology
+* Return number of cpus, cores and nodes
+*/
+std::string ThreadPlacement::describe() const
+{
+    std::stringstream ssDescription;
+    ssDescription << this->cpus.size() << " cpus, " << this->coreCount << " cores, "
+        << this->nodeCount << " NUMA nodes";
+    return ssDescription.str();
+}
+
+/*
+* Getter for the number of cpus
+*/
+unsigned int ThreadPlacement::getCpuCount() const
+{
+    return (unsigned int)this->cpus.size();
+}
+
+/*
+* Getter for the number of physical cores
+*/
+unsigned int ThreadPlacement::getCoreCount() const
+{
+    return (unsigned int)this->coreCount;
+}
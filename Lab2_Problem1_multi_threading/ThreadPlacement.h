@@ -0,0 +1,97 @@
+/*
+* Header file for the placement of the worker threads on the cpus
+*
+* The cpus, their cores and NUMA nodes are read from sysfs
+* (/sys/devices/system/cpu and /sys/devices/system/node). They are put in
+* the order the threads are placed in: one cpu of every core first, going
+* round the nodes so the threads are spread over the nodes, then the SMT
+* siblings of the cores. A thread can be pinned to its cpu or to all the
+* cpus of the node of its cpu. Pinning is only done on Linux, elsewhere the
+* threads are left to the OS.
+*/
+
+#ifndef __THREADPLACEMENT__HEADER__
+#define __THREADPLACEMENT__HEADER__
+
+#include <string>
+#include <vector>
+
+/*
+* Enum of the ways to pin the threads
+*/
+enum threadPinning
+{
+    pinNone,
+    pinCores,
+    pinNodes
+};
+
+/*
+* Struct to hold where a cpu is
+*/
+struct CpuPlace
+{
+    int cpu;        // index of the cpu in the OS
+    int core;       // physical core, unique over the packages
+    int node;       // NUMA node
+    int smtRank;    // 0 for the first cpu of its core, 1 for its first SMT sibling, ...
+};
+
+/*
+* Class to read the cpu topology and pin the threads
+*/
+class ThreadPlacement
+{
+    // Cpus in the order the threads are placed on them
+    std::vector<CpuPlace> cpus;
+    int coreCount;
+    int nodeCount;
+
+public:
+    /*
+    * Constructor to read the cpu topology
+    * Falls back to hardware_concurrency cpus on one node, each its own core, if sysfs can not be read
+    */
+    ThreadPlacement();
+
+    /*
+    * Function to find a way to pin the threads from its name
+    * @param name none, cores or nodes
+    * @param pinning reference to set the way to pin the threads
+    * Return bool if the name is a way to pin the threads
+    */
+    static bool findPinning(const char* name, threadPinning& pinning);
+
+    /*
+    * Function to pin the calling thread
+    * @param thread index of the thread, thread i gets the i-th cpu of the placement order
+    * @param pinning pin to the cpu, to all the cpus of its node or not at all
+    * Return bool if the thread was pinned
+    */
+    bool pinThread(unsigned int thread, threadPinning pinning) const;
+
+    /*
+    * Function to get the number of threads which share a core with another thread
+    * @param threadCount number of threads placed
+    * Return number of threads on the SMT siblings of cores already used
+    */
+    unsigned int getSmtThreadCount(unsigned int threadCount) const;
+
+    /*
+    * Function to describe the topology
+    * Return number of cpus, cores and nodes
+    */
+    std::string describe() const;
+
+    /*
+    * Getter for the number of cpus
+    */
+    unsigned int getCpuCount() const;
+
+    /*
+    * Getter for the number of physical cores
+    */
+    unsigned int getCoreCount() const;
+};
+
+#endif // !__THREADPLACEMENT__HEADER__
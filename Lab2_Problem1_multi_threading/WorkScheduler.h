@@ -0,0 +1,202 @@
+/*
+* Header file for the work stealing scheduler of the Monte Carlo runs
+*
+* The runs are cut into chunks and every thread starts with an equal,
+* contiguous range of chunks. A thread takes chunks from the front of its
+* own range, and once it is empty it steals the back half of the range of
+* another thread, so fast threads keep working while a slow one is behind
+* and all of them finish at about the same time.
+*
+* A range is one 64 bit atomic (first chunk << 32 | end chunk), so the
+* owner taking from the front and a thief taking from the back are both a
+* single compare and swap and can never take the same chunk.
+*/
+
+#ifndef __WORKSCHEDULER__HEADER__
+#define __WORKSCHEDULER__HEADER__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// Size of a cache line, data written by different threads is kept on different lines
+const std::size_t cacheLineSize = 64;
+
+/*
+* Class for an array with every item starting on its own cache line
+* operator new does not align to more than 16 bytes before C++17, so the
+* items are constructed in a buffer aligned by hand
+*/
+template <typename T>
+class CacheAlignedArray
+{
+    std::vector<unsigned char> storage;
+    T* items;
+    std::size_t count;
+
+    // Copying would leave items pointing into the old buffer
+    CacheAlignedArray(const CacheAlignedArray&);
+    CacheAlignedArray& operator= (const CacheAlignedArray&);
+
+public:
+    /*
+    * Constructor to create the items with their default constructor
+    * @param inCount number of items
+    */
+    explicit CacheAlignedArray(std::size_t inCount) : storage(inCount * sizeof(T) + cacheLineSize), count(inCount)
+    {
+        static_assert(sizeof(T) % cacheLineSize == 0, "items must fill whole cache lines");
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(this->storage.data());
+        address = (address + cacheLineSize - 1) / cacheLineSize * cacheLineSize;
+        this->items = reinterpret_cast<T*>(address);
+        for (std::size_t i = 0; i < this->count; ++i)
+        {
+            new (&this->items[i]) T();
+        }
+    }
+
+    /*
+    * Destructor to destroy the items
+    */
+    ~CacheAlignedArray()
+    {
+        for (std::size_t i = 0; i < this->count; ++i)
+        {
+            this->items[i].~T();
+        }
+    }
+
+    /*
+    * Overload operator []
+    */
+    T& operator[] (std::size_t index)
+    {
+        return this->items[index];
+    }
+
+    const T& operator[] (std::size_t index) const
+    {
+        return this->items[index];
+    }
+
+    /*
+    * Getter for the number of items
+    */
+    std::size_t size() const
+    {
+        return this->count;
+    }
+};
+
+/*
+* Struct for the range of chunks of a thread, alone on its cache line
+*/
+struct alignas(cacheLineSize) ChunkRange
+{
+    std::atomic<std::uint64_t> range;   // (first chunk << 32) | end chunk
+
+    ChunkRange() : range(0) {}
+};
+
+/*
+* Class to hand out the chunks of runs to the threads
+*/
+class WorkStealingScheduler
+{
+    CacheAlignedArray<ChunkRange> ranges;
+    unsigned long long totalRuns;
+    unsigned long chunkRuns;
+
+    /*
+    * Function to pack a range of chunks
+    */
+    static std::uint64_t packRange(std::uint64_t first, std::uint64_t end)
+    {
+        return (first << 32) | end;
+    }
+
+public:
+    /*
+    * Constructor to cut the runs into chunks and give each thread an equal range
+    * @param inTotalRuns number of runs to do
+    * @param inChunkRuns number of runs per chunk, the last chunk may be smaller
+    * @param threadCount number of threads
+    */
+    WorkStealingScheduler(unsigned long long inTotalRuns, unsigned long inChunkRuns, unsigned int threadCount) :
+        ranges(threadCount), totalRuns(inTotalRuns), chunkRuns(inChunkRuns)
+    {
+        std::uint64_t chunkCount = (inTotalRuns + inChunkRuns - 1) / inChunkRuns;
+        for (unsigned int i = 0; i < threadCount; ++i)
+        {
+            std::uint64_t first = chunkCount * i / threadCount;
+            std::uint64_t end = chunkCount * (i + 1) / threadCount;
+            this->ranges[i].range.store(packRange(first, end));
+        }
+    }
+
+    /*
+    * Function to get the next chunk for a thread
+    * Takes the first chunk of the range of the thread, or steals half of the
+    * range of another thread when its own range is empty
+    * @param thread index of the thread
+    * @param firstRun reference to set the index of the first run of the chunk
+    * @param runs reference to set the number of runs of the chunk
+    * Return bool if a chunk was found, false once all the chunks are taken
+    */
+    bool nextChunk(unsigned int thread, unsigned long long& firstRun, unsigned long& runs)
+    {
+        std::uint64_t chunk = 0;
+        bool found = false;
+
+        // Own range, from the front
+        std::atomic<std::uint64_t>& ownRange = this->ranges[thread].range;
+        std::uint64_t current = ownRange.load();
+        while ((current >> 32) < (current & 0xFFFFFFFFu))
+        {
+            if (ownRange.compare_exchange_weak(current, current + (1ULL << 32)))
+            {
+                chunk = current >> 32;
+                found = true;
+                break;
+            }
+        }
+
+        // Steal the back half of the range of the next thread with chunks left
+        unsigned int threadCount = (unsigned int)this->ranges.size();
+        for (unsigned int step = 1; not found && step < threadCount; ++step)
+        {
+            std::atomic<std::uint64_t>& victimRange = this->ranges[(thread + step) % threadCount].range;
+            std::uint64_t victim = victimRange.load();
+            while (not found)
+            {
+                std::uint64_t first = victim >> 32;
+                std::uint64_t end = victim & 0xFFFFFFFFu;
+                if (first >= end)
+                {
+                    break;
+                }
+                std::uint64_t stolen = (end - first + 1) / 2;
+                if (victimRange.compare_exchange_weak(victim, packRange(first, end - stolen)))
+                {
+                    // First stolen chunk is run now, the rest becomes the range of this thread
+                    chunk = end - stolen;
+                    ownRange.store(packRange(chunk + 1, end));
+                    found = true;
+                }
+            }
+        }
+
+        if (not found)
+        {
+            return false;
+        }
+        firstRun = chunk * this->chunkRuns;
+        runs = (unsigned long)std::min<unsigned long long>(this->chunkRuns, this->totalRuns - firstRun);
+        return true;
+    }
+};
+
+#endif // !__WORKSCHEDULER__HEADER__
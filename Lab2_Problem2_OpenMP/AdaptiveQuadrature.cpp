@@ -0,0 +1,196 @@
+/*
+* Implementation file for AdaptiveQuadrature.cpp
+*/
+
+#include "AdaptiveQuadrature.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <queue>
+#include <vector>
+
+#include "MidpointRule.h"
+
+// Kronrod nodes on [-1, 1], the odd ones are the Gauss nodes, the last one is the center
+static const double kronrodNodes[8] = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.000000000000000000000000000000000 };
+// Kronrod weights of the nodes
+static const double kronrodWeights[8] = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714 };
+// Gauss weights of the Gauss nodes 1, 3, 5 and the center
+static const double gaussWeights[4] = {
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327 };
+
+/*
+* Struct to order the intervals of the priority queue, worst error on top
+*/
+struct WorseError
+{
+    bool operator()(const QuadratureInterval& a, const QuadratureInterval& b) const
+    {
+        return a.error < b.error;
+    }
+};
+
+/*
+* Function to integrate over an interval with the 7 point Gauss and 15 point Kronrod rules
+* The error estimate is the one of QUADPACK qk15
+* @param integrand function to integrate, called from many threads at once
+* @param lowerBound lower bound of the interval
+* @param upperBound upper bound of the interval
+* Return interval with its Kronrod integral and error estimate
+*/
+QuadratureInterval integrateKronrod15(const std::function<double(double)>& integrand, double lowerBound,
+    double upperBound)
+{
+    double center = (lowerBound + upperBound) / 2;
+    double halfLength = (upperBound - lowerBound) / 2;
+
+    double centerValue = integrand(center);
+    double gaussSum = centerValue * gaussWeights[3];
+    double kronrodSum = centerValue * kronrodWeights[7];
+    double absoluteSum = fabs(kronrodSum);
+    double lowValues[7], highValues[7];
+    for (int node = 0; node < 7; ++node)
+    {
+        double offset = halfLength * kronrodNodes[node];
+        lowValues[node] = integrand(center - offset);
+        highValues[node] = integrand(center + offset);
+        double pairSum = lowValues[node] + highValues[node];
+        kronrodSum += kronrodWeights[node] * pairSum;
+        absoluteSum += kronrodWeights[node] * (fabs(lowValues[node]) + fabs(highValues[node]));
+        if (node % 2 == 1)
+        {
+            gaussSum += gaussWeights[node / 2] * pairSum;
+        }
+    }
+
+    // Spread of the integrand around its mean, scales the error estimate
+    double mean = kronrodSum / 2;
+    double spread = kronrodWeights[7] * fabs(centerValue - mean);
+    for (int node = 0; node < 7; ++node)
+    {
+        spread += kronrodWeights[node] * (fabs(lowValues[node] - mean) + fabs(highValues[node] - mean));
+    }
+
+    double width = fabs(halfLength);
+    absoluteSum *= width;
+    spread *= width;
+    double error = fabs((kronrodSum - gaussSum) * halfLength);
+    if (spread != 0 && error != 0)
+    {
+        error = spread * std::min(1.0, pow(200 * error / spread, 1.5));
+    }
+    bool roundingLimited = false;
+    if (absoluteSum > DBL_MIN / (50 * DBL_EPSILON))
+    {
+        // Rounding of the sums
+        roundingLimited = error <= 50 * DBL_EPSILON * absoluteSum;
+        error = std::max(50 * DBL_EPSILON * absoluteSum, error);
+    }
+
+    QuadratureInterval interval = { lowerBound, upperBound, kronrodSum * halfLength, error, roundingLimited };
+    return interval;
+}
+
+/*
+* Function to integrate with adaptive subdivision of the worst intervals
+* Intervals too narrow to split or with an error down to the rounding keep their error and are not split again
+* @param integrand function to integrate, called from many threads at once
+* @param lowerBound lower bound of the integral
+* @param upperBound upper bound of the integral
+* @param tolerance absolute error to stop at
+* Return integral, its error estimate and the work done
+*/
+QuadratureResult integrateAdaptive(const std::function<double(double)>& integrand, double lowerBound,
+    double upperBound, double tolerance)
+{
+    std::priority_queue<QuadratureInterval, std::vector<QuadratureInterval>, WorseError> queue;
+    std::vector<QuadratureInterval> finalIntervals;
+    std::vector<QuadratureInterval> splitIntervals;
+    std::vector<QuadratureInterval> halves(2 * adaptiveBatchIntervals);
+
+    QuadratureInterval whole = integrateKronrod15(integrand, lowerBound, upperBound);
+    queue.push(whole);
+    long long evaluations = kronrodPoints;
+    // Errors of the intervals in the queue and of the ones which can not be split, only used to stop,
+    // the result adds the errors up again
+    double queueError = whole.error;
+    double finalError = 0;
+
+    while (queueError + finalError > tolerance && finalError <= tolerance && not queue.empty() &&
+        (long long)(queue.size() + finalIntervals.size()) < maxAdaptiveIntervals)
+    {
+        // Always a full batch of the worst intervals, even once splitting fewer would be enough,
+        // so a refinement down into one point still gives every thread work in every round
+        splitIntervals.clear();
+        while (not queue.empty() && finalError <= tolerance && (int)splitIntervals.size() < adaptiveBatchIntervals)
+        {
+            QuadratureInterval interval = queue.top();
+            queue.pop();
+            double middle = (interval.lowerBound + interval.upperBound) / 2;
+            if (interval.roundingLimited || middle <= interval.lowerBound || middle >= interval.upperBound)
+            {
+                // Error down to the rounding or no double between the bounds, the error can not get smaller
+                queueError -= interval.error;
+                finalError += interval.error;
+                finalIntervals.push_back(interval);
+                continue;
+            }
+            splitIntervals.push_back(interval);
+        }
+
+        int halfCount = 2 * (int)splitIntervals.size();
+#pragma omp parallel for schedule(dynamic)
+        for (int half = 0; half < halfCount; ++half)
+        {
+            const QuadratureInterval& interval = splitIntervals[half / 2];
+            double middle = (interval.lowerBound + interval.upperBound) / 2;
+            halves[half] = half % 2 == 0 ? integrateKronrod15(integrand, interval.lowerBound, middle) :
+                integrateKronrod15(integrand, middle, interval.upperBound);
+        }
+
+        for (int half = 0; half < halfCount; ++half)
+        {
+            queueError += halves[half].error;
+            queue.push(halves[half]);
+        }
+        for (std::size_t i = 0; i < splitIntervals.size(); ++i)
+        {
+            queueError -= splitIntervals[i].error;
+        }
+        evaluations += (long long)halfCount * kronrodPoints;
+    }
+
+    // Intervals from left to right, added up in a fixed pairwise tree
+    while (not queue.empty())
+    {
+        finalIntervals.push_back(queue.top());
+        queue.pop();
+    }
+    std::sort(finalIntervals.begin(), finalIntervals.end(),
+        [](const QuadratureInterval& a, const QuadratureInterval& b) { return a.lowerBound < b.lowerBound; });
+    std::vector<double> integrals(finalIntervals.size());
+    std::vector<double> errors(finalIntervals.size());
+    for (std::size_t i = 0; i < finalIntervals.size(); ++i)
+    {
+        integrals[i] = finalIntervals[i].integral;
+        errors[i] = finalIntervals[i].error;
+    }
+
+    QuadratureResult result;
+    result.integral = sumPairwise(integrals.data(), (long long)integrals.size());
+    result.errorEstimate = sumPairwise(errors.data(), (long long)errors.size());
+    result.evaluations = evaluations;
+    result.intervals = (long long)finalIntervals.size();
+    result.converged = result.errorEstimate <= tolerance;
+    return result;
+}
@@ -0,0 +1,73 @@
+/*
+* Header file for the adaptive Gauss-Kronrod quadrature
+*
+* An interval is integrated with the 15 point Kronrod rule, its error is
+* estimated from the difference to the 7 point Gauss rule it contains (the
+* QUADPACK qk15 estimate). The intervals are kept in a priority queue on
+* their error. Every round takes the adaptiveBatchIntervals worst intervals
+* off the queue (fewer only when the queue runs out) and splits them in two
+* in a parallel loop. The round stays full when a few intervals would reach
+* the tolerance, so the threads have work however unbalanced the refinement
+* is, at the cost of splitting some intervals more than needed. The batch
+* size does not depend on the number of threads, so neither does the
+* result.
+*/
+
+#ifndef __ADAPTIVEQUADRATURE__HEADER__
+#define __ADAPTIVEQUADRATURE__HEADER__
+
+#include <functional>
+
+// Max intervals split in one round, 2 halves each are integrated in parallel
+const int adaptiveBatchIntervals = 64;
+// Max intervals of the refinement, the memory is bounded by it
+const long long maxAdaptiveIntervals = 1LL << 22;
+// Integrand evaluations of the 15 point Kronrod rule
+const int kronrodPoints = 15;
+
+/*
+* Struct to hold an interval and its integral
+*/
+struct QuadratureInterval
+{
+    double lowerBound;
+    double upperBound;
+    double integral;    // 15 point Kronrod integral
+    double error;       // error estimate of the integral
+    bool roundingLimited;   // whether the error is the rounding of the sums, splitting does not make it smaller
+};
+
+/*
+* Struct to hold the result of an adaptive integration
+*/
+struct QuadratureResult
+{
+    double integral;
+    double errorEstimate;   // sum of the error estimates of the intervals
+    long long evaluations;  // number of times the integrand was evaluated
+    long long intervals;    // number of intervals at the end
+    bool converged;         // whether the error estimate got below the tolerance
+};
+
+/*
+* Function to integrate over an interval with the 7 point Gauss and 15 point Kronrod rules
+* @param integrand function to integrate, called from many threads at once
+* @param lowerBound lower bound of the interval
+* @param upperBound upper bound of the interval
+* Return interval with its Kronrod integral and error estimate
+*/
+QuadratureInterval integrateKronrod15(const std::function<double(double)>& integrand, double lowerBound,
+    double upperBound);
+
+/*
+* Function to integrate with adaptive subdivision of the worst intervals
+* @param integrand function to integrate, called from many threads at once
+* @param lowerBound lower bound of the integral
+* @param upperBound upper bound of the integral
+* @param tolerance absolute error to stop at
+* Return integral, its error estimate and the work done
+*/
+QuadratureResult integrateAdaptive(const std::function<double(double)>& integrand, double lowerBound,
+    double upperBound, double tolerance);
+
+#endif // !__ADAPTIVEQUADRATURE__HEADER__
@@ -0,0 +1,740 @@
+/*
+* Implementation file for ExpressionProgram.cpp
+*/
+
+#include "ExpressionProgram.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "MidpointRule.h"
+
+/*
+* Struct to hold a compiled sub expression, a constant or a register
+*/
+struct ExpressionValue
+{
+    bool isConstant;
+    double constant;
+    int reg;
+};
+
+/*
+* Struct to hold a function name of the grammar
+*/
+struct ExpressionFunction
+{
+    const char* name;
+    expressionOperation operation;
+};
+
+static const ExpressionFunction expressionFunctions[] = {
+    { "exp", opExp }, { "log", opLog }, { "sqrt", opSqrt }, { "sin", opSin }, { "cos", opCos },
+    { "tan", opTan }, { "atan", opAtan }, { "sinh", opSinh }, { "cosh", opCosh }, { "tanh", opTanh },
+    { "abs", opAbs } };
+
+/*
+* Function to apply an operation to values
+* @param operation operation to apply
+* @param left first value
+* @param right second value, not used by the operations of one value
+* Return result of the operation
+*/
+static inline double applyOperation(expressionOperation operation, double left, double right)
+{
+    switch (operation)
+    {
+    case opAdd: return left + right;
+    case opSubtract: return left - right;
+    case opMultiply: return left * right;
+    case opDivide: return left / right;
+    case opPower: return pow(left, right);
+    case opNegate: return -left;
+    case opExp: return exp(left);
+    case opLog: return log(left);
+    case opSqrt: return sqrt(left);
+    case opSin: return sin(left);
+    case opCos: return cos(left);
+    case opTan: return tan(left);
+    case opAtan: return atan(left);
+    case opSinh: return sinh(left);
+    case opCosh: return cosh(left);
+    case opTanh: return tanh(left);
+    case opAbs: return fabs(left);
+    }
+    return NAN;
+}
+
+/*
+* Class to parse an expression and emit the bytecode, one parse per compile
+*/
+class ExpressionCompiler
+{
+    const char* text;
+    const char* position;
+    std::vector<ExpressionInstruction>& instructions;
+    std::vector<int>& constantRegisters;
+    std::vector<double>& constantValues;
+    // Registers free to use again, the registers of the variables are never free
+    std::vector<int> freeRegisters;
+    int registerCount;
+    int dimension;
+    std::string error;
+
+    /*
+    * Function to stop the parse with an error, only the first error is kept
+    */
+    void fail(const char* reason)
+    {
+        if (this->error.empty())
+        {
+            this->error = std::string(reason) + " at position " + std::to_string(this->position - this->text);
+        }
+    }
+
+    /*
+    * Function to move past the spaces
+    */
+    void skipSpaces()
+    {
+        while (isspace((unsigned char)*this->position))
+        {
+            ++this->position;
+        }
+    }
+
+    /*
+    * Function to move past a character if it is next
+    * @param c character to look for
+    * Return bool if the character was next
+    */
+    bool accept(char c)
+    {
+        skipSpaces();
+        if (*this->position == c)
+        {
+            ++this->position;
+            return true;
+        }
+        return false;
+    }
+
+    /*
+    * Function to get a register to write, a free one if there is one
+    * @param fresh whether the register must never have been used, constant registers are set before the
+    *     instructions run and would be written over by the instructions of a temporary
+    */
+    int allocateRegister(bool fresh = false)
+    {
+        if (not fresh && not this->freeRegisters.empty())
+        {
+            int reg = this->freeRegisters.back();
+            this->freeRegisters.pop_back();
+            return reg;
+        }
+        if (this->registerCount == maxExpressionRegisters)
+        {
+            fail("expression too deep");
+            return 0;
+        }
+        return this->registerCount++;
+    }
+
+    /*
+    * Function to give back the register of a sub expression once it is read
+    * Constant registers are set once per run and are never written, so they are kept
+    */
+    void releaseValue(const ExpressionValue& value)
+    {
+        if (not value.isConstant && value.reg >= maxExpressionVariables)
+        {
+            this->freeRegisters.push_back(value.reg);
+        }
+    }
+
+    /*
+    * Function to get a register holding a value, constants get a register of their own
+    */
+    int getRegister(const ExpressionValue& value)
+    {
+        if (not value.isConstant)
+        {
+            return value.reg;
+        }
+        for (std::size_t i = 0; i < this->constantValues.size(); ++i)
+        {
+            if (this->constantValues[i] == value.constant)
+            {
+                return this->constantRegisters[i];
+            }
+        }
+        int reg = allocateRegister(true);
+        this->constantRegisters.push_back(reg);
+        this->constantValues.push_back(value.constant);
+        return reg;
+    }
+
+    /*
+    * Function to emit an operation, folded if its values are constants
+    * @param operation operation to emit
+    * @param left first value
+    * @param right second value, ignored by the operations of one value
+    * @param binary whether the operation reads right
+    * Return value of the operation
+    */
+    ExpressionValue emit(expressionOperation operation, const ExpressionValue& left, const ExpressionValue& right,
+        bool binary)
+    {
+        ExpressionValue result = { false, 0, 0 };
+        if (left.isConstant && (not binary || right.isConstant))
+        {
+            result.isConstant = true;
+            result.constant = applyOperation(operation, left.constant, right.constant);
+            return result;
+        }
+
+        ExpressionInstruction instruction;
+        instruction.operation = operation;
+        instruction.left = getRegister(left);
+        instruction.right = binary ? getRegister(right) : instruction.left;
+        // The registers read are free once the instruction is emitted, so the target may be one of them
+        releaseValue(left);
+        if (binary)
+        {
+            releaseValue(right);
+        }
+        result.reg = allocateRegister();
+        instruction.target = result.reg;
+        this->instructions.push_back(instruction);
+        return result;
+    }
+
+    /*
+    * Functions to parse the rules of the grammar, they emit the instructions and return the value of the rule
+    */
+    ExpressionValue parseExpression()
+    {
+        ExpressionValue value = parseTerm();
+        while (this->error.empty())
+        {
+            if (accept('+'))
+            {
+                value = emit(opAdd, value, parseTerm(), true);
+            }
+            else if (accept('-'))
+            {
+                value = emit(opSubtract, value, parseTerm(), true);
+            }
+            else
+            {
+                break;
+            }
+        }
+        return value;
+    }
+
+    ExpressionValue parseTerm()
+    {
+        ExpressionValue value = parseUnary();
+        while (this->error.empty())
+        {
+            if (accept('*'))
+            {
+                value = emit(opMultiply, value, parseUnary(), true);
+            }
+            else if (accept('/'))
+            {
+                value = emit(opDivide, value, parseUnary(), true);
+            }
+            else
+            {
+                break;
+            }
+        }
+        return value;
+    }
+
+    ExpressionValue parseUnary()
+    {
+        if (accept('-'))
+        {
+            ExpressionValue value = parseUnary();
+            return emit(opNegate, value, value, false);
+        }
+        if (accept('+'))
+        {
+            return parseUnary();
+        }
+        return parsePower();
+    }
+
+    ExpressionValue parsePower()
+    {
+        ExpressionValue value = parsePrimary();
+        if (this->error.empty() && accept('^'))
+        {
+            ExpressionValue exponent = parseUnary();
+            value = exponent.isConstant && not value.isConstant ? emitConstantPower(value, exponent.constant) :
+                emit(opPower, value, exponent, true);
+        }
+        return value;
+    }
+
+    /*
+    * Function to emit a power with a constant exponent
+    * Small integer exponents are done by squaring and 0.5 by sqrt, pow is far slower than a few multiplications
+    * @param base value to raise
+    * @param exponent constant exponent
+    * Return value of the power
+    */
+    ExpressionValue emitConstantPower(const ExpressionValue& base, double exponent)
+    {
+        ExpressionValue constant = { true, exponent, 0 };
+        if (exponent == 0.5)
+        {
+            return emit(opSqrt, base, base, false);
+        }
+        if (exponent != floor(exponent) || fabs(exponent) > 64 || exponent == 0)
+        {
+            return emit(opPower, base, constant, true);
+        }
+
+        // Bits of the exponent from the highest, square then multiply by the base
+        int bits = (int)fabs(exponent);
+        int bit = 1;
+        while (bit * 2 <= bits)
+        {
+            bit *= 2;
+        }
+        ExpressionValue result = base;
+        // The base is read again for every set bit, it must keep its register until the end
+        bool baseIsTemporary = base.reg >= maxExpressionVariables;
+        for (bit /= 2; bit > 0 && this->error.empty(); bit /= 2)
+        {
+            result = emitKeeping(opMultiply, result, result, base, baseIsTemporary);
+            if (bits & bit)
+            {
+                result = emitKeeping(opMultiply, result, base, base, baseIsTemporary);
+            }
+        }
+        if (baseIsTemporary && result.reg != base.reg)
+        {
+            releaseValue(base);
+        }
+        if (exponent < 0)
+        {
+            ExpressionValue one = { true, 1, 0 };
+            result = emit(opDivide, one, result, true);
+        }
+        return result;
+    }
+
+    /*
+    * Function to emit a multiplication of a power without freeing the register of its base
+    */
+    ExpressionValue emitKeeping(expressionOperation operation, const ExpressionValue& left,
+        const ExpressionValue& right, const ExpressionValue& base, bool baseIsTemporary)
+    {
+        ExpressionInstruction instruction;
+        instruction.operation = operation;
+        instruction.left = left.reg;
+        instruction.right = right.reg;
+        if (left.reg != base.reg || not baseIsTemporary)
+        {
+            releaseValue(left);
+        }
+        ExpressionValue result = { false, 0, allocateRegister() };
+        instruction.target = result.reg;
+        this->instructions.push_back(instruction);
+        return result;
+    }
+
+    ExpressionValue parsePrimary()
+    {
+        ExpressionValue value = { true, NAN, 0 };
+        skipSpaces();
+        if (accept('('))
+        {
+            value = parseExpression();
+            if (not accept(')'))
+            {
+                fail("missing )");
+            }
+            return value;
+        }
+        if (isdigit((unsigned char)*this->position) || *this->position == '.')
+        {
+            char* end = NULL;
+            value.constant = strtod(this->position, &end);
+            if (end == this->position)
+            {
+                fail("number expected");
+            }
+            this->position = end;
+            return value;
+        }
+        if (isalpha((unsigned char)*this->position))
+        {
+            const char* start = this->position;
+            while (isalnum((unsigned char)*this->position))
+            {
+                ++this->position;
+            }
+            std::string name(start, this->position);
+            // x or x1 to x20, without leading zeros
+            int variable = name == "x" ? 1 : 0;
+            if (name.size() >= 2 && name.size() <= 3 && name[0] == 'x' && name[1] != '0' &&
+                std::all_of(name.begin() + 1, name.end(), [](char c) { return isdigit((unsigned char)c) != 0; }))
+            {
+                variable = atoi(name.c_str() + 1);
+            }
+            if (variable >= 1 && variable <= maxExpressionVariables)
+            {
+                this->dimension = std::max(this->dimension, variable);
+                value.isConstant = false;
+                value.reg = variable - 1;
+                return value;
+            }
+            if (name == "pi")
+            {
+                value.constant = 3.14159265358979323846;
+                return value;
+            }
+            if (name == "e")
+            {
+                value.constant = 2.71828182845904523536;
+                return value;
+            }
+            for (std::size_t i = 0; i < sizeof(expressionFunctions) / sizeof(expressionFunctions[0]); ++i)
+            {
+                if (name == expressionFunctions[i].name)
+                {
+                    if (not accept('('))
+                    {
+                        fail("missing (");
+                        return value;
+                    }
+                    ExpressionValue argument = parseExpression();
+                    if (not accept(')'))
+                    {
+                        fail("missing )");
+                        return value;
+                    }
+                    return emit(expressionFunctions[i].operation, argument, argument, false);
+                }
+            }
+            this->position = start;
+            fail("unknown name");
+            return value;
+        }
+        fail("number, x, function or ( expected");
+        return value;
+    }
+
+public:
+    /*
+    * Constructor to compile a text into the given program parts
+    */
+    ExpressionCompiler(const char* text, std::vector<ExpressionInstruction>& instructions,
+        std::vector<int>& constantRegisters, std::vector<double>& constantValues) :
+        text(text), position(text), instructions(instructions), constantRegisters(constantRegisters),
+        constantValues(constantValues), registerCount(maxExpressionVariables), dimension(0)
+    {
+    }
+
+    /*
+    * Function to compile the whole text
+    * @param resultRegister reference to set the register holding the value of the expression
+    * @param registerCount reference to set the number of registers used
+    * @param dimension reference to set the highest variable of the expression
+    * @param error reference to set the reason the text is not valid
+    * Return bool if the text is a valid expression
+    */
+    bool compile(int& resultRegister, int& registerCount, int& dimension, std::string& error)
+    {
+        ExpressionValue value = parseExpression();
+        skipSpaces();
+        if (this->error.empty() && *this->position != '\0')
+        {
+            fail("unexpected character");
+        }
+        if (not this->error.empty())
+        {
+            error = this->error;
+            return false;
+        }
+        resultRegister = getRegister(value);
+        registerCount = this->registerCount;
+        dimension = this->dimension;
+        if (not this->error.empty())
+        {
+            error = this->error;
+            return false;
+        }
+        return true;
+    }
+};
+
+/*
+* Constructor to create a program of the expression x
+*/
+ExpressionProgram::ExpressionProgram() : registerCount(maxExpressionVariables), resultRegister(0), dimension(1)
+{
+}
+
+/*
+* Function to parse and compile an expression
+* @param text expression to compile
+* @param error reference to set the reason the expression is not valid
+* Return bool if the expression is valid, the program is left as it was if not
+*/
+bool ExpressionProgram::compile(const std::string& text, std::string& error)
+{
+    std::vector<ExpressionInstruction> newInstructions;
+    std::vector<int> newConstantRegisters;
+    std::vector<double> newConstantValues;
+    ExpressionCompiler compiler(text.c_str(), newInstructions, newConstantRegisters, newConstantValues);
+    int newResultRegister = 0, newRegisterCount = 0, newDimension = 0;
+    if (not compiler.compile(newResultRegister, newRegisterCount, newDimension, error))
+    {
+        return false;
+    }
+    this->instructions.swap(newInstructions);
+    this->constantRegisters.swap(newConstantRegisters);
+    this->constantValues.swap(newConstantValues);
+    this->resultRegister = newResultRegister;
+    this->registerCount = newRegisterCount;
+    this->dimension = newDimension;
+    return true;
+}
+
+/*
+* Function to compile and evaluate an expression without variables, like a bound
+* @param text expression to evaluate
+* @param value reference to set the value of the expression
+* Return bool if the text is an expression without variables with a finite value
+*/
+bool ExpressionProgram::evaluateConstant(const std::string& text, double& value)
+{
+    ExpressionProgram program;
+    std::string error;
+    if (not program.compile(text, error) || program.dependsOnX())
+    {
+        return false;
+    }
+    value = program.evaluate(0);
+    return std::isfinite(value);
+}
+
+/*
+* Function to set the constant registers, once before the batches of a run
+* @param registers registers of the run
+*/
+void ExpressionProgram::setConstants(ExpressionRegisters& registers) const
+{
+    for (std::size_t i = 0; i < this->constantRegisters.size(); ++i)
+    {
+        double* target = registers[this->constantRegisters[i]];
+        double value = this->constantValues[i];
+        for (int j = 0; j < expressionBatch; ++j)
+        {
+            target[j] = value;
+        }
+    }
+}
+
+/*
+* Function to run the bytecode over a batch
+* One switch per instruction, the loops over the batch vectorize
+* @param registers registers of the run, the registers of the variables hold the points
+* @param count number of values of the batch
+* Return values of the expression, in one of the registers
+*/
+const double* ExpressionProgram::runBatch(ExpressionRegisters& registers, int count) const
+{
+    for (std::size_t i = 0; i < this->instructions.size(); ++i)
+    {
+        const ExpressionInstruction& instruction = this->instructions[i];
+        double* target = registers[instruction.target];
+        const double* left = registers[instruction.left];
+        const double* right = registers[instruction.right];
+        switch (instruction.operation)
+        {
+        case opAdd:
+#pragma omp simd
+            for (int j = 0; j < count; ++j) target[j] = left[j] + right[j];
+            break;
+        case opSubtract:
+#pragma omp simd
+            for (int j = 0; j < count; ++j) target[j] = left[j] - right[j];
+            break;
+        case opMultiply:
+#pragma omp simd
+            for (int j = 0; j < count; ++j) target[j] = left[j] * right[j];
+            break;
+        case opDivide:
+#pragma omp simd
+            for (int j = 0; j < count; ++j) target[j] = left[j] / right[j];
+            break;
+        case opNegate:
+#pragma omp simd
+            for (int j = 0; j < count; ++j) target[j] = -left[j];
+            break;
+        case opSqrt:
+#pragma omp simd
+            for (int j = 0; j < count; ++j) target[j] = sqrt(left[j]);
+            break;
+        case opAbs:
+#pragma omp simd
+            for (int j = 0; j < count; ++j) target[j] = fabs(left[j]);
+            break;
+        default:
+            // Library functions, one call per value
+            for (int j = 0; j < count; ++j) target[j] = applyOperation(instruction.operation, left[j], right[j]);
+            break;
+        }
+    }
+    return registers[this->resultRegister];
+}
+
+/*
+* Function to evaluate the expression at one point
+* Runs the bytecode on single values, for the callers which need one value at a time
+* @param x value of x
+* Return value of the expression
+*/
+double ExpressionProgram::evaluate(double x) const
+{
+    double registers[maxExpressionRegisters];
+    for (std::size_t i = 0; i < this->constantRegisters.size(); ++i)
+    {
+        registers[this->constantRegisters[i]] = this->constantValues[i];
+    }
+    registers[0] = x;
+    for (std::size_t i = 0; i < this->instructions.size(); ++i)
+    {
+        const ExpressionInstruction& instruction = this->instructions[i];
+        registers[instruction.target] = applyOperation(instruction.operation, registers[instruction.left],
+            registers[instruction.right]);
+    }
+    return registers[this->resultRegister];
+}
+
+/*
+* Function to sum the expression at the midpoints of a range of steps
+* The values of a batch are summed in simdLanes lane sums, which are Kahan added to the sums of the range
+* @param lowerBound lower bound of the integral
+* @param stepSize width of a step
+* @param firstStep index of the first step of the range
+* @param stepCount number of steps of the range
+* Return sum of the expression at the midpoints of the steps, not multiplied by the step size
+*/
+double ExpressionProgram::sumMidpoints(double lowerBound, double stepSize, long long firstStep,
+    long long stepCount) const
+{
+    alignas(64) ExpressionRegisters registers;
+    alignas(64) double laneSums[simdLanes] = { 0 };
+    alignas(64) double laneCompensations[simdLanes] = { 0 };
+    alignas(64) double batchSums[simdLanes];
+    setConstants(registers);
+
+    long long step = firstStep;
+    const long long endStep = firstStep + stepCount;
+    while (step < endStep)
+    {
+        int count = (int)std::min<long long>(expressionBatch, endStep - step);
+#pragma omp simd
+        for (int j = 0; j < count; ++j)
+        {
+            registers[0][j] = lowerBound + ((double)(step + j) + 0.5) * stepSize;
+        }
+        const double* values = runBatch(registers, count);
+
+        // Values past count are left as zero so the lanes add up whole rounds
+        for (int lane = 0; lane < simdLanes; ++lane)
+        {
+            batchSums[lane] = 0;
+        }
+        int wholeCount = count / simdLanes * simdLanes;
+        for (int j = 0; j < wholeCount; j += simdLanes)
+        {
+#pragma omp simd aligned(batchSums : 64)
+            for (int lane = 0; lane < simdLanes; ++lane)
+            {
+                batchSums[lane] += values[j + lane];
+            }
+        }
+        for (int j = wholeCount; j < count; ++j)
+        {
+            batchSums[j - wholeCount] += values[j];
+        }
+
+#pragma omp simd aligned(laneSums, laneCompensations, batchSums : 64)
+        for (int lane = 0; lane < simdLanes; ++lane)
+        {
+            double value = batchSums[lane] - laneCompensations[lane];
+            double total = laneSums[lane] + value;
+            // An overflowed sum keeps no compensation, inf - inf would turn it into NaN
+            laneCompensations[lane] = std::isfinite(total) ? (total - laneSums[lane]) - value : 0;
+            laneSums[lane] = total;
+        }
+        step += count;
+    }
+
+    for (int lane = 0; lane < simdLanes; ++lane)
+    {
+        laneSums[lane] -= laneCompensations[lane];
+    }
+    return sumPairwise(laneSums, simdLanes);
+}
+
+/*
+* Getter for whether the expression depends on x
+*/
+bool ExpressionProgram::dependsOnX() const
+{
+    return this->dimension > 0;
+}
+
+/*
+* Getter for the highest variable of the expression, 1 for an expression of x
+*/
+int ExpressionProgram::getDimension() const
+{
+    return this->dimension;
+}
+
+/*
+* Getter for the number of instructions
+*/
+int ExpressionProgram::getInstructionCount() const
+{
+    return (int)this->instructions.size();
+}
+
+/*
+* Function to get the number of floating point operations of an evaluation, + - * / negate sqrt and abs
+*/
+int ExpressionProgram::getArithmeticCount() const
+{
+    return getInstructionCount() - getLibraryCallCount();
+}
+
+/*
+* Function to get the number of library calls of an evaluation, exp log pow and the trigonometric functions
+*/
+int ExpressionProgram::getLibraryCallCount() const
+{
+    int calls = 0;
+    for (std::size_t i = 0; i < this->instructions.size(); ++i)
+    {
+        expressionOperation operation = this->instructions[i].operation;
+        bool arithmetic = operation == opAdd || operation == opSubtract || operation == opMultiply ||
+            operation == opDivide || operation == opNegate || operation == opSqrt || operation == opAbs;
+        calls += arithmetic ? 0 : 1;
+    }
+    return calls;
+}
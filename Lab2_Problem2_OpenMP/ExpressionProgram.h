@@ -0,0 +1,167 @@
+/*
+* Header file for the integrand expressions
+*
+* An expression of x like "14 * exp(7 * x)" is parsed once and compiled to
+* a register bytecode: every instruction reads one or two registers and
+* writes one. The variables x1 to x20 of a multi dimensional integrand are
+* in the first registers, x is x1 and is in register 0. Constant sub expressions are folded when
+* compiling and the registers of finished sub expressions are used again,
+* so few registers are needed. A register is a batch of expressionBatch
+* values and every instruction is an omp simd loop over the batch, so the
+* decoding of an instruction is paid once for expressionBatch values of x.
+*
+* Grammar, usual precedence, ^ is right associative:
+*     expression := term (('+' | '-') term)*
+*     term       := unary (('*' | '/') unary)*
+*     unary      := '-' unary | power
+*     power      := primary ('^' unary)?
+*     primary    := number | variable | pi | e | function '(' expression ')' | '(' expression ')'
+*     variable   := x | x1 | x2 | ... | x20
+*     function   := exp | log | sqrt | sin | cos | tan | atan | sinh | cosh | tanh | abs
+*/
+
+#ifndef __EXPRESSIONPROGRAM__HEADER__
+#define __EXPRESSIONPROGRAM__HEADER__
+
+#include <string>
+#include <vector>
+
+// Values of x evaluated by one run of the bytecode, a multiple of simdLanes
+const int expressionBatch = 256;
+// Max variables of an expression, the registers 0 to maxExpressionVariables - 1 hold them
+const int maxExpressionVariables = 20;
+// Max registers of a program, the variables and the temporaries, bounds the nesting of the expression
+const int maxExpressionRegisters = 64;
+
+// Registers of a run of the bytecode, one batch of values each
+typedef double ExpressionRegisters[maxExpressionRegisters][expressionBatch];
+
+/*
+* Enum of the bytecode operations
+*/
+enum expressionOperation
+{
+    opAdd,
+    opSubtract,
+    opMultiply,
+    opDivide,
+    opPower,
+    opNegate,
+    opExp,
+    opLog,
+    opSqrt,
+    opSin,
+    opCos,
+    opTan,
+    opAtan,
+    opSinh,
+    opCosh,
+    opTanh,
+    opAbs
+};
+
+/*
+* Struct to hold an instruction, right is not used by the operations of one value
+*/
+struct ExpressionInstruction
+{
+    expressionOperation operation;
+    int target;
+    int left;
+    int right;
+};
+
+/*
+* Class to compile and run an integrand expression
+*/
+class ExpressionProgram
+{
+    std::vector<ExpressionInstruction> instructions;
+    // Registers holding constants and their values, set once per run
+    std::vector<int> constantRegisters;
+    std::vector<double> constantValues;
+    int registerCount;
+    int resultRegister;
+    // Highest variable of the expression, 0 for a constant
+    int dimension;
+
+public:
+    /*
+    * Constructor to create a program of the expression x
+    */
+    ExpressionProgram();
+
+    /*
+    * Function to parse and compile an expression
+    * @param text expression to compile
+    * @param error reference to set the reason the expression is not valid
+    * Return bool if the expression is valid, the program is left as it was if not
+    */
+    bool compile(const std::string& text, std::string& error);
+
+    /*
+    * Function to set the constant registers, once before the batches of a run
+    * @param registers registers of the run
+    */
+    void setConstants(ExpressionRegisters& registers) const;
+
+    /*
+    * Function to run the bytecode over a batch
+    * @param registers registers of the run, the registers of the variables hold the points
+    * @param count number of values of the batch
+    * Return values of the expression, in one of the registers
+    */
+    const double* runBatch(ExpressionRegisters& registers, int count) const;
+
+    /*
+    * Function to compile and evaluate an expression without variables, like a bound
+    * @param text expression to evaluate
+    * @param value reference to set the value of the expression
+    * Return bool if the text is an expression without variables with a finite value
+    */
+    static bool evaluateConstant(const std::string& text, double& value);
+
+    /*
+    * Function to evaluate the expression at one point
+    * @param x value of x
+    * Return value of the expression
+    */
+    double evaluate(double x) const;
+
+    /*
+    * Function to sum the expression at the midpoints of a range of steps
+    * @param lowerBound lower bound of the integral
+    * @param stepSize width of a step
+    * @param firstStep index of the first step of the range
+    * @param stepCount number of steps of the range
+    * Return sum of the expression at the midpoints of the steps, not multiplied by the step size
+    */
+    double sumMidpoints(double lowerBound, double stepSize, long long firstStep, long long stepCount) const;
+
+    /*
+    * Getter for whether the expression depends on x
+    */
+    bool dependsOnX() const;
+
+    /*
+    * Getter for the highest variable of the expression, 1 for an expression of x
+    */
+    int getDimension() const;
+
+    /*
+    * Getter for the number of instructions
+    */
+    int getInstructionCount() const;
+
+    /*
+    * Function to get the number of floating point operations of an evaluation, + - * / negate sqrt and abs
+    */
+    int getArithmeticCount() const;
+
+    /*
+    * Function to get the number of library calls of an evaluation, exp log pow and the trigonometric functions
+    */
+    int getLibraryCallCount() const;
+};
+
+#endif // !__EXPRESSIONPROGRAM__HEADER__
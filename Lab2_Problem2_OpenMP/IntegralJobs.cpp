@@ -0,0 +1,175 @@
+/*
+* Implementation file for IntegralJobs.cpp
+*/
+
+#include "IntegralJobs.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+
+#include "ExpressionProgram.h"
+#include "MidpointRule.h"
+
+/*
+* Struct to hold a job and the sums of its blocks
+*/
+struct IntegralJob
+{
+    int line;
+    ExpressionProgram integrand;
+    double lowerBound;
+    double upperBound;
+    long long stepCount;
+    long long blockSteps;
+    long long blockCount;
+    long long firstItem;        // index of its first block in the loop over the blocks of all the jobs
+    std::vector<double> blockSums;
+};
+
+/*
+* Function to remove the spaces around a field
+*/
+static std::string trimField(const std::string& field)
+{
+    std::size_t first = field.find_first_not_of(" \t\r");
+    std::size_t last = field.find_last_not_of(" \t\r");
+    return first == std::string::npos ? std::string() : field.substr(first, last - first + 1);
+}
+
+/*
+* Function to read a job from a line
+* @param text line of the job file
+* @param job reference to set the integral of the line
+* @param error reference to set the reason the line is not valid
+* Return bool if the line is a valid job
+*/
+static bool parseJob(const std::string& text, IntegralJob& job, std::string& error)
+{
+    std::vector<std::string> fields;
+    std::stringstream ssLine(text);
+    std::string field;
+    while (fields.size() < 3 && std::getline(ssLine, field, ';'))
+    {
+        fields.push_back(trimField(field));
+    }
+    // The expression is the rest of the line
+    if (fields.size() == 3 && std::getline(ssLine, field))
+    {
+        fields.push_back(trimField(field));
+    }
+    if (fields.size() != 4)
+    {
+        error = "expected <number of steps>; <lower bound>; <upper bound>; <expression>";
+        return false;
+    }
+
+    const std::string& steps = fields[0];
+    bool digits = std::all_of(steps.begin(), steps.end(), [](char c) { return isdigit((unsigned char)c) != 0; });
+    if (steps.empty() || not digits || steps.size() > 18 || (job.stepCount = atoll(steps.c_str())) <= 0)
+    {
+        error = "number of steps";
+        return false;
+    }
+    if (not ExpressionProgram::evaluateConstant(fields[1], job.lowerBound) ||
+        not ExpressionProgram::evaluateConstant(fields[2], job.upperBound))
+    {
+        error = "bounds";
+        return false;
+    }
+    if (not job.integrand.compile(fields[3], error))
+    {
+        return false;
+    }
+    if (job.integrand.getDimension() > 1)
+    {
+        error = "more than one variable";
+        return false;
+    }
+    return true;
+}
+
+/*
+* Function to integrate the jobs of a job file
+* The loop over the blocks of all the jobs is the only parallel region, a counter per job finds its last block
+* @param inFile job file to read
+* @param outFile stream to write the result lines to, flushed after every line
+* Return counts of the jobs
+*/
+JobBatchResult runIntegralJobs(std::istream& inFile, std::ostream& outFile)
+{
+    JobBatchResult result = { 0, 0, 0, 0 };
+    std::vector<IntegralJob> jobs;
+    std::string text;
+    long long itemCount = 0;
+    for (int line = 1; std::getline(inFile, text); ++line)
+    {
+        std::string trimmed = trimField(text);
+        if (trimmed.empty() || trimmed[0] == '#')
+        {
+            continue;
+        }
+        IntegralJob job;
+        std::string error;
+        if (not parseJob(trimmed, job, error))
+        {
+            // Invalid lines are written before any job is run
+            outFile << line << " Invalid inputs: " << error << std::endl;
+            ++result.invalidJobs;
+            continue;
+        }
+        job.line = line;
+        job.blockSteps = getBlockSteps(job.stepCount);
+        job.blockCount = (job.stepCount + job.blockSteps - 1) / job.blockSteps;
+        job.firstItem = itemCount;
+        job.blockSums.resize(job.blockCount);
+        itemCount += job.blockCount;
+        result.evaluations += job.stepCount;
+        jobs.push_back(job);
+    }
+    result.jobs = (long long)jobs.size();
+
+    std::vector<long long> blocksLeft(jobs.size());
+    std::vector<long long> firstItems(jobs.size());
+    for (std::size_t j = 0; j < jobs.size(); ++j)
+    {
+        blocksLeft[j] = jobs[j].blockCount;
+        firstItems[j] = jobs[j].firstItem;
+    }
+
+    double startTime = omp_get_wtime();
+#pragma omp parallel for schedule(dynamic)
+    for (long long item = 0; item < itemCount; ++item)
+    {
+        std::size_t j = (std::size_t)(std::upper_bound(firstItems.begin(), firstItems.end(), item) -
+            firstItems.begin()) - 1;
+        IntegralJob& job = jobs[j];
+        long long block = item - job.firstItem;
+        long long firstStep = block * job.blockSteps;
+        double stepSize = (job.upperBound - job.lowerBound) / job.stepCount;
+        job.blockSums[block] = job.integrand.sumMidpoints(job.lowerBound, stepSize, firstStep,
+            std::min(job.blockSteps, job.stepCount - firstStep));
+
+        long long left;
+#pragma omp atomic capture seq_cst
+        left = --blocksLeft[j];
+        if (left == 0)
+        {
+            // Last block of the job, the seq_cst counter and the flush make the sums of the other blocks visible
+#pragma omp flush
+            double integral = sumPairwise(job.blockSums.data(), job.blockCount) * stepSize;
+#pragma omp critical
+            {
+                outFile << job.line << " " << std::fixed << std::setprecision(15) << integral << std::endl;
+            }
+        }
+    }
+    result.seconds = omp_get_wtime() - startTime;
+    return result;
+}
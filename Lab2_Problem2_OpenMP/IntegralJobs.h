@@ -0,0 +1,43 @@
+/*
+* Header file for the batch of integrals of a job file
+*
+* A job file has one integral per line:
+*     <number of steps>; <lower bound>; <upper bound>; <expression of x>
+* Empty lines and lines starting with # are skipped. Every job is cut into
+* the blocks of the midpoint rule (see MidpointRule.h) and the blocks of all
+* the jobs are shared out by one parallel loop with a dynamic schedule, so
+* there is one fork and join for the whole file and a thread takes the next
+* block of any job as soon as it is free. The thread finishing the last
+* block of a job adds its blocks up and writes its line at once, so the
+* lines come out in the order the jobs finish. The blocks and their sum are
+* the ones of a single integral, a job gives the same bits as ./sim with
+* the same integral.
+*/
+
+#ifndef __INTEGRALJOBS__HEADER__
+#define __INTEGRALJOBS__HEADER__
+
+#include <istream>
+#include <ostream>
+
+/*
+* Struct to hold the counts of a batch of jobs
+*/
+struct JobBatchResult
+{
+    long long jobs;             // number of valid jobs integrated
+    long long invalidJobs;      // number of lines which were not a valid job
+    long long evaluations;      // number of steps of all the jobs
+    double seconds;             // time of the parallel region
+};
+
+/*
+* Function to integrate the jobs of a job file
+* Every result line is "<line number> <integral>" or "<line number> Invalid inputs: <reason>"
+* @param inFile job file to read
+* @param outFile stream to write the result lines to, flushed after every line
+* Return counts of the jobs
+*/
+JobBatchResult runIntegralJobs(std::istream& inFile, std::ostream& outFile);
+
+#endif // !__INTEGRALJOBS__HEADER__
@@ -0,0 +1,145 @@
+/*
+* Implementation file for IntegratorBenchmark.cpp
+*/
+
+#include "IntegratorBenchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+
+#include "ExpressionProgram.h"
+#include "MidpointRule.h"
+
+/*
+* Struct to hold a timed run of the benchmark
+*/
+struct BenchmarkRun
+{
+    int kernel;     // 0 for the recurrence, 1 for the bytecode
+    int scaling;    // 0 for strong, 1 for weak scaling
+    int threads;
+    long long steps;
+    double seconds;
+    double integral;
+};
+
+/*
+* Function to get the name of the binding of the threads
+*/
+static const char* getProcBindName()
+{
+    switch (omp_get_proc_bind())
+    {
+    case omp_proc_bind_false: return "false";
+    case omp_proc_bind_true: return "true";
+    case omp_proc_bind_master: return "master";
+    case omp_proc_bind_close: return "close";
+    case omp_proc_bind_spread: return "spread";
+    }
+    return "unknown";
+}
+
+/*
+* Function to run the benchmark and write it as JSON
+* Flops per step: 2 for the recurrence (add and multiply), for the bytecode the arithmetic of the expression
+* and 4 to make the midpoint and add it; the library calls are counted on their own
+* @param outFile stream to write the JSON to
+* @param maxSteps largest step count of the sweep, per thread for the weak scaling
+*/
+void runIntegratorBenchmark(std::ostream& outFile, long long maxSteps)
+{
+    const double lowerBound = 0;
+    const double upperBound = log(2) / 7;
+    const ExponentialIntegrand exponential = { 14, 7 };
+    const char* expression = "14 * exp(7 * x)";
+    ExpressionProgram program;
+    std::string error;
+    program.compile(expression, error);
+    const double exact = getExponentialIntegral(exponential, lowerBound, upperBound);
+
+    const int maxThreads = omp_get_max_threads();
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+    std::vector<long long> stepCounts;
+    for (long long steps = minBenchmarkSteps; steps <= maxSteps; steps *= 10)
+    {
+        stepCounts.push_back(steps);
+    }
+
+    // Starts the thread team so the first run does not pay for it
+    integrateExponentialMidpoint(exponential, lowerBound, upperBound, minBenchmarkSteps);
+
+    std::vector<BenchmarkRun> runs;
+    const char* kernels[2] = { "recurrence", "bytecode" };
+    const char* scalings[2] = { "strong", "weak" };
+    for (int kernel = 0; kernel < 2; ++kernel)
+    {
+        for (int scaling = 0; scaling < 2; ++scaling)
+        {
+            for (std::size_t s = 0; s < stepCounts.size(); ++s)
+            {
+                for (std::size_t t = 0; t < threadCounts.size(); ++t)
+                {
+                    BenchmarkRun run = { kernel, scaling, threadCounts[t],
+                        stepCounts[s] * (scaling == 1 ? threadCounts[t] : 1), INFINITY, 0 };
+                    omp_set_num_threads(run.threads);
+                    for (int repeat = 0; repeat < benchmarkRepeats; ++repeat)
+                    {
+                        double startTime = omp_get_wtime();
+                        run.integral = kernel == 0 ?
+                            integrateExponentialMidpoint(exponential, lowerBound, upperBound, run.steps) :
+                            integrateExpressionMidpoint(program, lowerBound, upperBound, run.steps);
+                        run.seconds = std::min(run.seconds, omp_get_wtime() - startTime);
+                    }
+                    runs.push_back(run);
+                }
+            }
+        }
+    }
+    omp_set_num_threads(maxThreads);
+
+    const double flopsPerStep[2] = { 2, (double)program.getArithmeticCount() + 4 };
+    const double callsPerStep[2] = { (double)simdLanes / resyncSteps, (double)program.getLibraryCallCount() };
+
+    outFile << std::setprecision(17);
+    outFile << "{\n";
+    outFile << "  \"integrand\": \"" << expression << "\",\n";
+    outFile << "  \"lowerBound\": " << lowerBound << ",\n";
+    outFile << "  \"upperBound\": " << upperBound << ",\n";
+    outFile << "  \"exact\": " << exact << ",\n";
+    outFile << "  \"cpus\": " << omp_get_num_procs() << ",\n";
+    outFile << "  \"maxThreads\": " << maxThreads << ",\n";
+    outFile << "  \"procBind\": \"" << getProcBindName() << "\",\n";
+    outFile << "  \"repeats\": " << benchmarkRepeats << ",\n";
+    outFile << "  \"runs\": [";
+    for (std::size_t i = 0; i < runs.size(); ++i)
+    {
+        const BenchmarkRun& run = runs[i];
+        // Run with 1 thread of the same kernel, scaling and steps per thread
+        const BenchmarkRun& single = runs[i - i % threadCounts.size()];
+        double speedup = single.seconds / run.seconds * (run.scaling == 1 ? run.threads : 1);
+        double evaluationsPerSecond = run.steps / run.seconds;
+
+        outFile << (i == 0 ? "\n" : ",\n") << std::setprecision(6);
+        outFile << "    { \"kernel\": \"" << kernels[run.kernel] << "\", \"scaling\": \"" << scalings[run.scaling]
+            << "\", \"threads\": " << run.threads << ", \"steps\": " << run.steps
+            << ", \"seconds\": " << run.seconds
+            << ", \"evaluationsPerSecond\": " << evaluationsPerSecond
+            << ", \"gflops\": " << evaluationsPerSecond * flopsPerStep[run.kernel] * 1e-9
+            << ", \"libraryCallsPerSecond\": " << evaluationsPerSecond * callsPerStep[run.kernel]
+            << ", \"speedup\": " << speedup
+            << ", \"efficiency\": " << speedup / run.threads
+            << std::setprecision(17) << ", \"integral\": " << run.integral
+            << std::setprecision(6) << ", \"relativeError\": " << fabs(run.integral - exact) / fabs(exact) << " }";
+    }
+    outFile << "\n  ]\n}\n";
+}
@@ -0,0 +1,32 @@
+/*
+* Header file for the scaling benchmark of the midpoint rule
+*
+* The integral of 14 * e^(7x) from 0 to ln(2) / 7, whose closed form is 2,
+* is timed with the two kernels: the exponential recurrence, which calls
+* exp once every resyncSteps steps, and the bytecode of the expression,
+* which calls exp for every step. The gap between the two is the cost of
+* exp. Every step count is timed over the thread counts 1, 2, 4, ... up
+* to the max number of threads, once with the same steps for every thread
+* count (strong scaling) and once with the steps times the threads (weak
+* scaling). The runs are written as JSON so they can be compared from one
+* build to the next.
+*/
+
+#ifndef __INTEGRATORBENCHMARK__HEADER__
+#define __INTEGRATORBENCHMARK__HEADER__
+
+#include <ostream>
+
+// Smallest step count of the sweep, the step counts go up by 10 to the max
+const long long minBenchmarkSteps = 1000000;
+// Runs of a measure, the fastest one is kept
+const int benchmarkRepeats = 3;
+
+/*
+* Function to run the benchmark and write it as JSON
+* @param outFile stream to write the JSON to
+* @param maxSteps largest step count of the sweep, per thread for the weak scaling
+*/
+void runIntegratorBenchmark(std::ostream& outFile, long long maxSteps);
+
+#endif // !__INTEGRATORBENCHMARK__HEADER__
@@ -3,6 +3,47 @@ Description:
     Solution file for Problem 2 in Lab 2
     Implemented Numerical integration using mid-point rule
        and openmp library for multithreading
+    The steps are counted with integers and the integrand is summed by the
+       vectorized kernel of MidpointRule.h, in blocks added up in a fixed order
+       so the result is the same for any number of threads
+    The Romberg mode refines the trapezoid rule until the Richardson
+       extrapolation of RombergRule.h is within the tolerance
+    The adaptive mode splits the worst intervals of the Gauss-Kronrod
+       quadrature of AdaptiveQuadrature.h until it is within the tolerance
+    The integrand and the bounds are expressions compiled at run time to the
+       bytecode of ExpressionProgram.h, the default integrand 14 * e^(7x) is
+       summed by the exponential kernel of MidpointRule.h
+    The quasi Monte Carlo mode integrates an expression of x1 to x20 over a
+       cube with the scrambled Sobol points of QuasiMonteCarlo.h
+    The job mode integrates all the lines of a job file in one parallel
+       region (see IntegralJobs.h)
+    The benchmark mode times the kernels over the thread and step counts and
+       writes the scaling as JSON (see IntegratorBenchmark.h)
+
+    Usage:
+        ./sim <number of steps> [options]   -> integral, by default of 14 * exp(7 * x) from 0 to log(2) / 7,
+                                               written to Lab2Prob2.txt
+        ./sim --romberg <tolerance> [options]
+                                            -> same integral by Romberg integration, with its error estimate and
+                                               number of evaluations
+        ./sim --adaptive <tolerance> [options]
+                                            -> same integral by adaptive Gauss-Kronrod quadrature, with its error
+                                               estimate, number of evaluations and intervals
+        ./sim --qmc <points> [options] [--dimension <d>] [--replicates <n>] [--seed <n>]
+                                            -> integral over the cube [lower, upper]^d by quasi Monte Carlo, with
+                                               <points> scrambled Sobol points in each of the replicates
+        ./sim --jobs <job file>             -> midpoint rule integrals of the lines "<steps>; <lower>; <upper>;
+                                               <expression>" of the file, one line "<line> <integral>" per job in
+                                               the order they finish
+        ./sim --benchmark <max steps>       -> strong and weak scaling of the midpoint rule kernels from 1e6 steps up
+                                               to <max steps>, written as JSON to Lab2Prob2.json
+        Options:
+        --function <expression>     integrand, an expression of x like "1 / (1 + x^2)", or of x1 to x20
+                                    for --qmc
+        --bounds <lower> <upper>    bounds of the integral, expressions without x like "pi / 2"
+        --dimension <d>             dimension of the cube, default the highest variable of the integrand
+        --replicates <n>            number of independent scrambles, default 16
+        --seed <n>                  seed of the scrambles, default from std::random_device
 */
 
 #include <iostream>
@@ -10,9 +51,19 @@ Description:
 #include <omp.h>
 #include <string>
 #include <cstring>
+#include <cstdlib>
 #include <algorithm>
 #include <fstream>
 #include <iomanip>
+#include <random>
+
+#include "AdaptiveQuadrature.h"
+#include "ExpressionProgram.h"
+#include "IntegralJobs.h"
+#include "IntegratorBenchmark.h"
+#include "MidpointRule.h"
+#include "QuasiMonteCarlo.h"
+#include "RombergRule.h"
 
 /*
 * Function to check whether the input argument is a number,
@@ -23,20 +74,20 @@ Description:
 * @param ulInNumber reference to original variable to set
 * Returns: bool if input is a number
 */
-bool convertToNumbers(const char* charsToCheck, double& ulInNumber)
+bool convertToNumbers(const char* charsToCheck, long long& ulInNumber)
 {
     try
     {
         // Check to see if the char array is a number
         // Using lambda function to check if each char is a number
-        bool check = std::all_of(charsToCheck, charsToCheck + strlen(charsToCheck),
+        bool check = strlen(charsToCheck) > 0 && std::all_of(charsToCheck, charsToCheck + strlen(charsToCheck),
             [](unsigned char c) { return ::isdigit(c); });
         if (check)
         {
             // Char array is a valid number 
             std::string strToCheck(charsToCheck);
-            ulInNumber = std::stod(strToCheck);
-            if (ulInNumber >= 0)
+            ulInNumber = std::stoll(strToCheck);
+            if (ulInNumber > 0)
             {
                 return true;
             }
@@ -49,6 +100,40 @@ bool convertToNumbers(const char* charsToCheck, double& ulInNumber)
     }
 }
 
+/*
+* Function to check whether the input argument is a positive floating point number,
+* if so, then set the number through reference
+* else, return false
+*
+* @param charsToCheck char array to verify
+* @param inNumber reference to original variable to set
+* Returns: bool if input is a positive finite number
+*/
+bool convertToTolerance(const char* charsToCheck, double& inNumber)
+{
+    char* end = NULL;
+    double number = strtod(charsToCheck, &end);
+    if (end == charsToCheck || *end != '\0' || not std::isfinite(number) || number <= 0)
+    {
+        return false;
+    }
+    inNumber = number;
+    return true;
+}
+
+/*
+* Enum of the ways to integrate
+*/
+enum integrationMode
+{
+    midpointMode,
+    rombergMode,
+    adaptiveMode,
+    qmcMode,
+    jobsMode,
+    benchmarkMode
+};
+
 int main(int argc, char* argv[])
 {
     // Open output stream to write data into out file
@@ -62,66 +147,193 @@ int main(int argc, char* argv[])
         return 1;
     }
 
-    if (argc != 2)
+    // store the lower and upper bound
+    double lowerBound = 0;
+    double upperBound = log(2) / 7;
+
+    // integrand 14 * e^(7x)
+    const ExponentialIntegrand exponential = { 14, 7 };
+    ExpressionProgram integrand;
+    std::string error;
+    bool functionGiven = false;
+    integrand.compile("14 * exp(7 * x)", error);
+
+    integrationMode mode = midpointMode;
+    long long stepNumber{ 0 };
+    double tolerance = 0;
+    long long dimension = 0;
+    long long replicates = 16;
+    long long seed = 0;
+    bool seedGiven = false;
+    bool validArgs = argc >= 2;
+    int i = 1;
+    if (validArgs && strcmp(argv[1], "--romberg") == 0)
     {
-        // Check 1: Expected input args = 1 (+ the executable)
-        // Print error if more or less inputs provided
-        ofOutFile << "Invalid inputs";
-        ofOutFile.close();
-        return 1;
+        mode = rombergMode;
+        validArgs = argc >= 3 && convertToTolerance(argv[2], tolerance);
+        i = 3;
+    }
+    else if (validArgs && strcmp(argv[1], "--adaptive") == 0)
+    {
+        mode = adaptiveMode;
+        validArgs = argc >= 3 && convertToTolerance(argv[2], tolerance);
+        i = 3;
+    }
+    else if (validArgs && strcmp(argv[1], "--qmc") == 0)
+    {
+        // Every replicate is at most 2^32 points of the sequence
+        mode = qmcMode;
+        validArgs = argc >= 3 && convertToNumbers(argv[2], stepNumber) && stepNumber <= (1LL << sobolBits);
+        i = 3;
+    }
+    else if (validArgs && strcmp(argv[1], "--jobs") == 0)
+    {
+        // The jobs give their own integrands and bounds, there are no options
+        mode = jobsMode;
+        validArgs = argc == 3;
+        i = 3;
+    }
+    else if (validArgs && strcmp(argv[1], "--benchmark") == 0)
+    {
+        // The benchmark always times the integral of the lab, there are no options
+        mode = benchmarkMode;
+        validArgs = argc == 3 && convertToNumbers(argv[2], stepNumber) && stepNumber >= minBenchmarkSteps &&
+            stepNumber <= 1000000000000LL;
+        i = 3;
+    }
+    else if (validArgs)
+    {
+        // Convert the char array into the required number
+        validArgs = convertToNumbers(argv[1], stepNumber);
+        i = 2;
     }
 
-    double stepNumber{ 0 };
+    for (; i < argc && validArgs; ++i)
+    {
+        if (strcmp(argv[i], "--function") == 0 && i + 1 < argc)
+        {
+            validArgs = integrand.compile(argv[++i], error);
+            functionGiven = true;
+        }
+        else if (strcmp(argv[i], "--bounds") == 0 && i + 2 < argc)
+        {
+            validArgs = ExpressionProgram::evaluateConstant(argv[i + 1], lowerBound) &&
+                ExpressionProgram::evaluateConstant(argv[i + 2], upperBound);
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--dimension") == 0 && i + 1 < argc && mode == qmcMode)
+        {
+            validArgs = convertToNumbers(argv[++i], dimension) && dimension <= maxSobolDimension;
+        }
+        else if (strcmp(argv[i], "--replicates") == 0 && i + 1 < argc && mode == qmcMode)
+        {
+            validArgs = convertToNumbers(argv[++i], replicates) && replicates <= 1024;
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc && mode == qmcMode)
+        {
+            validArgs = convertToNumbers(argv[++i], seed);
+            seedGiven = true;
+        }
+        else
+        {
+            validArgs = false;
+        }
+    }
+    // Only the quasi Monte Carlo mode has more than one variable
+    validArgs = validArgs && (mode == qmcMode || integrand.getDimension() <= 1);
 
-    // Convert the char array into the required number
-    if (not convertToNumbers(argv[1], stepNumber))
+    if (not validArgs)
     {
-        // Check 2: Print error if the input is not a number
+        // Print error if the inputs are not a mode, numbers and options
         ofOutFile << "Invalid inputs";
+        if (not error.empty())
+        {
+            ofOutFile << ": " << error;
+        }
         ofOutFile.close();
         return 1;
     }
 
-    // store the lower and upper bound
-    double lowerBound = 0;
-    double upperBound = log(2) / 7;
-
-    // store the step size
-    double stepSize = (upperBound - lowerBound) / stepNumber;
-
-    // tracker for total sum
-    double sum = 0;
-
-    int maxThreadCount = omp_get_max_threads(); // storing to avoid calling again in each thread
-
-    // Range of each thread
-    double threadRange = (upperBound - lowerBound) / maxThreadCount;
-
-    // init variables for thread
-    double partialSum{ 0 }, threadLowerBound{ 0 }, threadUpperBound{ 0 };
-    int threadNum{ 0 };
+    if (mode == benchmarkMode)
+    {
+        std::ofstream ofJsonFile("Lab2Prob2.json", std::ios::trunc);
+        if (not ofJsonFile.is_open())
+        {
+            ofOutFile << "Unable to open output file: Lab2Prob2.json";
+            ofOutFile.close();
+            return 1;
+        }
+        runIntegratorBenchmark(ofJsonFile, stepNumber);
+        ofJsonFile.close();
+        ofOutFile << "Benchmark written to Lab2Prob2.json";
+        ofOutFile.close();
+        return 0;
+    }
 
-#pragma omp parallel private (threadNum, partialSum, threadLowerBound, threadUpperBound)
+    if (mode == jobsMode)
     {
-        // Get thread number
-        threadNum = omp_get_thread_num();
-        // Get lower bound for summation
-        threadLowerBound = lowerBound + threadRange * threadNum;
-        // Get upper bound for summation
-        threadUpperBound = threadLowerBound + threadRange;
+        std::ifstream inFile(argv[2]);
+        if (not inFile.is_open())
+        {
+            ofOutFile << "Unable to open job file: " << argv[2];
+            ofOutFile.close();
+            return 1;
+        }
+        JobBatchResult result = runIntegralJobs(inFile, ofOutFile);
+        ofOutFile << "# Jobs: " << result.jobs << ", invalid: " << result.invalidJobs << ", steps: "
+            << result.evaluations << ", time: " << std::fixed << std::setprecision(3) << result.seconds << " s";
+        ofOutFile.close();
+        return result.invalidJobs == 0 ? 0 : 1;
+    }
 
-        // Iterate through the bounds and add to partial sum
-        for (; threadLowerBound <= threadUpperBound; threadLowerBound += stepSize)
+    if (mode == qmcMode)
+    {
+        if (not seedGiven)
         {
-            partialSum += 14 * exp(7 * threadLowerBound) * stepSize;
+            std::random_device rd;
+            seed = (long long)((((unsigned long long)rd() << 32) | rd()) >> 1);
         }
+        int cubeDimension = std::max(1, std::max((int)dimension, integrand.getDimension()));
+        QmcResult result = integrateQuasiMonteCarlo(integrand, cubeDimension, lowerBound, upperBound, stepNumber,
+            (int)replicates, (std::uint64_t)seed);
+        ofOutFile << std::fixed << std::setprecision(15) << result.integral << "\n\n";
+        ofOutFile << std::scientific << std::setprecision(3) << "Standard error (replicates): "
+            << result.standardError << "\n\n";
+        ofOutFile << "Monte Carlo standard error with the same evaluations: " << result.monteCarloError << "\n\n";
+        ofOutFile << "Dimension: " << cubeDimension << ", replicates: " << replicates << ", points per replicate: "
+            << stepNumber << ", evaluations: " << result.evaluations << "\n\n";
+        ofOutFile << "Seed: " << seed;
+        ofOutFile.close();
+        return 0;
+    }
 
-        // Add the partial sum to the main sum
-#pragma omp critical
-        // Critical section to protect the shared variable sum during write
-        sum += partialSum;
+    if (mode == rombergMode)
+    {
+        RombergResult result = integrateRomberg(integrand, lowerBound, upperBound, tolerance);
+        ofOutFile << std::fixed << std::setprecision(15) << result.integral << "\n\n";
+        ofOutFile << std::scientific << std::setprecision(3) << "Error estimate: " << result.errorEstimate
+            << (result.converged ? "" : " (tolerance not reached)") << "\n\n";
+        ofOutFile << "Levels: " << result.levels << ", evaluations: " << result.evaluations;
+        ofOutFile.close();
+        return result.converged ? 0 : 1;
     }
 
+    if (mode == adaptiveMode)
+    {
+        QuadratureResult result = integrateAdaptive([&integrand](double x) { return integrand.evaluate(x); },
+            lowerBound, upperBound, tolerance);
+        ofOutFile << std::fixed << std::setprecision(15) << result.integral << "\n\n";
+        ofOutFile << std::scientific << std::setprecision(3) << "Error estimate: " << result.errorEstimate
+            << (result.converged ? "" : " (tolerance not reached)") << "\n\n";
+        ofOutFile << "Intervals: " << result.intervals << ", evaluations: " << result.evaluations;
+        ofOutFile.close();
+        return result.converged ? 0 : 1;
+    }
+
+    // Blocks of steps are shared out over the threads, the result does not depend on the thread count
+    double sum = functionGiven ? integrateExpressionMidpoint(integrand, lowerBound, upperBound, stepNumber) :
+        integrateExponentialMidpoint(exponential, lowerBound, upperBound, stepNumber);
+
     // Print output to the file and close
     ofOutFile << std::fixed << std::setprecision(6) << sum;
     ofOutFile.close();
@@ -0,0 +1,170 @@
+/*
+* Implementation file for MidpointRule.cpp
+*/
+
+#include "MidpointRule.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "ExpressionProgram.h"
+
+/*
+* Function to sum an exponential at the midpoints of a range of steps
+* Lane k of a round is step + k, it goes simdLanes steps further every round
+* A segment is summed in plain lane sums, which are Kahan added to the sums of the range
+* @param integrand exponential to sum
+* @param lowerBound lower bound of the integral
+* @param stepSize width of a step
+* @param firstStep index of the first step of the range
+* @param stepCount number of steps of the range
+* Return sum of the integrand at the midpoints of the steps, not multiplied by the step size
+*/
+double sumExponentialMidpoints(const ExponentialIntegrand& integrand, double lowerBound, double stepSize,
+    long long firstStep, long long stepCount)
+{
+    alignas(64) double laneSums[simdLanes] = { 0 };
+    alignas(64) double laneCompensations[simdLanes] = { 0 };
+    alignas(64) double segmentSums[simdLanes];
+    alignas(64) double laneValues[simdLanes];
+    // Ratio of the values of a lane from one round to the next
+    const double laneFactor = exp(integrand.rate * stepSize * simdLanes);
+
+    long long step = firstStep;
+    const long long endStep = firstStep + stepCount;
+    while (endStep - step >= simdLanes)
+    {
+        long long rounds = std::min((endStep - step) / simdLanes, resyncSteps / simdLanes);
+
+        // Exact values at the start of every segment
+        for (int lane = 0; lane < simdLanes; ++lane)
+        {
+            laneValues[lane] = exp(integrand.rate * (lowerBound + ((double)(step + lane) + 0.5) * stepSize));
+            segmentSums[lane] = 0;
+        }
+        for (long long round = 0; round < rounds; ++round)
+        {
+#pragma omp simd aligned(segmentSums, laneValues : 64)
+            for (int lane = 0; lane < simdLanes; ++lane)
+            {
+                segmentSums[lane] += laneValues[lane];
+                laneValues[lane] *= laneFactor;
+            }
+        }
+#pragma omp simd aligned(laneSums, laneCompensations, segmentSums : 64)
+        for (int lane = 0; lane < simdLanes; ++lane)
+        {
+            double value = segmentSums[lane] - laneCompensations[lane];
+            double total = laneSums[lane] + value;
+            // An overflowed sum keeps no compensation, inf - inf would turn it into NaN
+            laneCompensations[lane] = std::isfinite(total) ? (total - laneSums[lane]) - value : 0;
+            laneSums[lane] = total;
+        }
+        step += rounds * simdLanes;
+    }
+
+    for (int lane = 0; lane < simdLanes; ++lane)
+    {
+        laneSums[lane] -= laneCompensations[lane];
+    }
+    double sum = sumPairwise(laneSums, simdLanes);
+    // Steps left over after the last whole round
+    for (; step < endStep; ++step)
+    {
+        sum += exp(integrand.rate * (lowerBound + ((double)step + 0.5) * stepSize));
+    }
+    return integrand.scale * sum;
+}
+
+/*
+* Function to get the number of steps of a block
+* @param stepCount number of steps of the integral
+* Return steps of a block, only depends on stepCount
+*/
+long long getBlockSteps(long long stepCount)
+{
+    long long blockSteps = (stepCount + maxBlockCount - 1) / maxBlockCount;
+    blockSteps = (blockSteps + minBlockSteps - 1) / minBlockSteps * minBlockSteps;
+    return std::max(blockSteps, minBlockSteps);
+}
+
+/*
+* Function to add up values in a fixed pairwise tree
+* The first half and the second half are added up on their own, down to 8 values
+* @param values values to add up
+* @param count number of values
+* Return sum of the values, the same for the same values whatever the thread count
+*/
+double sumPairwise(const double* values, long long count)
+{
+    if (count <= 8)
+    {
+        double sum = 0;
+        for (long long i = 0; i < count; ++i)
+        {
+            sum += values[i];
+        }
+        return sum;
+    }
+    long long half = count / 2;
+    return sumPairwise(values, half) + sumPairwise(values + half, count - half);
+}
+
+/*
+* Function to integrate with the midpoint rule over all the threads
+* The blocks are shared out over the threads, every block sum only depends on its steps
+* @param sumRange function summing the integrand at the midpoints of a range of steps
+* @param lowerBound lower bound of the integral
+* @param upperBound upper bound of the integral
+* @param stepCount number of steps
+* Return integral, bit identical for any number of threads
+*/
+template<typename SumRange>
+static double integrateBlocks(const SumRange& sumRange, double lowerBound, double upperBound, long long stepCount)
+{
+    double stepSize = (upperBound - lowerBound) / stepCount;
+    long long blockSteps = getBlockSteps(stepCount);
+    long long blockCount = (stepCount + blockSteps - 1) / blockSteps;
+    std::vector<double> blockSums(blockCount);
+
+#pragma omp parallel for schedule(static)
+    for (long long block = 0; block < blockCount; ++block)
+    {
+        long long firstStep = block * blockSteps;
+        blockSums[block] = sumRange(lowerBound, stepSize, firstStep, std::min(blockSteps, stepCount - firstStep));
+    }
+    return sumPairwise(blockSums.data(), blockCount) * stepSize;
+}
+
+/*
+* Function to integrate an exponential with the midpoint rule over all the threads
+* @param integrand exponential to integrate
+* @param lowerBound lower bound of the integral
+* @param upperBound upper bound of the integral
+* @param stepCount number of steps
+* Return integral, bit identical for any number of threads
+*/
+double integrateExponentialMidpoint(const ExponentialIntegrand& integrand, double lowerBound, double upperBound,
+    long long stepCount)
+{
+    return integrateBlocks([&integrand](double lower, double stepSize, long long firstStep, long long count)
+        { return sumExponentialMidpoints(integrand, lower, stepSize, firstStep, count); },
+        lowerBound, upperBound, stepCount);
+}
+
+/*
+* Function to integrate an expression with the midpoint rule over all the threads
+* @param integrand compiled expression to integrate
+* @param lowerBound lower bound of the integral
+* @param upperBound upper bound of the integral
+* @param stepCount number of steps
+* Return integral, bit identical for any number of threads
+*/
+double integrateExpressionMidpoint(const ExpressionProgram& integrand, double lowerBound, double upperBound,
+    long long stepCount)
+{
+    return integrateBlocks([&integrand](double lower, double stepSize, long long firstStep, long long count)
+        { return integrand.sumMidpoints(lower, stepSize, firstStep, count); },
+        lowerBound, upperBound, stepCount);
+}
@@ -0,0 +1,109 @@
+/*
+* Header file for the midpoint rule kernels
+*
+* The steps are counted with integers, the midpoint of step i being
+* lowerBound + (i + 0.5) * stepSize, so there is no floating point loop
+* counter to drift and a range of steps can be given to any thread.
+*
+* An exponential scale * e^(rate * x) is summed without calling exp for
+* every step: simdLanes steps are done side by side in an omp simd loop and
+* every lane is multiplied by e^(rate * simdLanes * stepSize) to get its
+* next value. The lanes are set from exp again every resyncSteps steps, so
+* the rounding of the products can not build up.
+*
+* An integral is cut into blocks of a fixed number of steps, which only
+* depends on the number of steps. The lane sums of every segment are Kahan
+* added to the lane sums of the block and the block sums are added up in a
+* fixed pairwise tree, so the result is the same for any number of threads
+* and does not depend on which thread did which block.
+*/
+
+#ifndef __MIDPOINTRULE__HEADER__
+#define __MIDPOINTRULE__HEADER__
+
+#include <cmath>
+
+class ExpressionProgram;
+
+// Steps done side by side, enough independent sums to hide the latency of the adds
+const int simdLanes = 16;
+// Steps between two exact evaluations of the lanes, a multiple of simdLanes
+const long long resyncSteps = 1024;
+// Min steps of a block, a multiple of resyncSteps
+const long long minBlockSteps = 65536;
+// Max number of blocks, bigger integrals get bigger blocks so the block sums have a fixed max size
+const long long maxBlockCount = 65536;
+
+/*
+* Struct to hold the integrand scale * e^(rate * x)
+*/
+struct ExponentialIntegrand
+{
+    double scale;
+    double rate;
+};
+
+/*
+* Function to get the exact integral of an exponential
+* @param integrand exponential to integrate
+* @param lowerBound lower bound of the integral
+* @param upperBound upper bound of the integral
+* Return closed form of the integral
+*/
+inline double getExponentialIntegral(const ExponentialIntegrand& integrand, double lowerBound, double upperBound)
+{
+    // expm1 keeps the digits of a short interval
+    return integrand.scale / integrand.rate * exp(integrand.rate * lowerBound) *
+        expm1(integrand.rate * (upperBound - lowerBound));
+}
+
+/*
+* Function to sum an exponential at the midpoints of a range of steps
+* @param integrand exponential to sum
+* @param lowerBound lower bound of the integral
+* @param stepSize width of a step
+* @param firstStep index of the first step of the range
+* @param stepCount number of steps of the range
+* Return sum of the integrand at the midpoints of the steps, not multiplied by the step size
+*/
+double sumExponentialMidpoints(const ExponentialIntegrand& integrand, double lowerBound, double stepSize,
+    long long firstStep, long long stepCount);
+
+/*
+* Function to get the number of steps of a block
+* @param stepCount number of steps of the integral
+* Return steps of a block, only depends on stepCount
+*/
+long long getBlockSteps(long long stepCount);
+
+/*
+* Function to add up values in a fixed pairwise tree
+* @param values values to add up
+* @param count number of values
+* Return sum of the values, the same for the same values whatever the thread count
+*/
+double sumPairwise(const double* values, long long count);
+
+/*
+* Function to integrate an exponential with the midpoint rule over all the threads
+* @param integrand exponential to integrate
+* @param lowerBound lower bound of the integral
+* @param upperBound upper bound of the integral
+* @param stepCount number of steps
+* Return integral, bit identical for any number of threads
+*/
+double integrateExponentialMidpoint(const ExponentialIntegrand& integrand, double lowerBound, double upperBound,
+    long long stepCount);
+
+/*
+* Function to integrate an expression with the midpoint rule over all the threads
+* @param integrand compiled expression to integrate
+* @param lowerBound lower bound of the integral
+* @param upperBound upper bound of the integral
+* @param stepCount number of steps
+* Return integral, bit identical for any number of threads
+*/
+double integrateExpressionMidpoint(const ExpressionProgram& integrand, double lowerBound, double upperBound,
+    long long stepCount);
+
+#endif // !__MIDPOINTRULE__HEADER__
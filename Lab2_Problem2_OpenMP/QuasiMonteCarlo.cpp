@@ -0,0 +1,152 @@
+/*
+* Implementation file for QuasiMonteCarlo.cpp
+*/
+
+#include "QuasiMonteCarlo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "MidpointRule.h"
+#include "SobolSequence.h"
+
+/*
+* Struct to hold the sums of a block of points
+*/
+struct QmcBlockSums
+{
+    double sum;
+    double squares;
+};
+
+/*
+* Function to sum the integrand over a block of points of a sequence
+* @param integrand compiled expression of the coordinates
+* @param sequence scrambled sequence of the replicate
+* @param lowerBound lower bound of every variable
+* @param width width of the range of every variable
+* @param firstIndex index of the first point of the block
+* @param pointCount number of points of the block
+* Return sum of the integrand and of its squares over the points
+*/
+static QmcBlockSums sumSobolPoints(const ExpressionProgram& integrand, const SobolSequence& sequence,
+    double lowerBound, double width, long long firstIndex, long long pointCount)
+{
+    alignas(64) ExpressionRegisters registers;
+    alignas(64) double laneSums[simdLanes] = { 0 };
+    alignas(64) double laneSquares[simdLanes] = { 0 };
+    std::uint32_t point[maxSobolDimension];
+    integrand.setConstants(registers);
+    const int dimension = sequence.getDimension();
+
+    sequence.getPoint((std::uint64_t)firstIndex, point);
+    long long index = firstIndex;
+    const long long endIndex = firstIndex + pointCount;
+    while (index < endIndex)
+    {
+        int count = (int)std::min<long long>(expressionBatch, endIndex - index);
+        for (int j = 0; j < count; ++j)
+        {
+            for (int d = 0; d < dimension; ++d)
+            {
+                registers[d][j] = lowerBound + width * SobolSequence::toUnit(point[d]);
+            }
+            // No next point after the last one of the block, which may be the last point of the sequence
+            if (index + j + 1 < endIndex)
+            {
+                sequence.nextPoint((std::uint64_t)(index + j), point);
+            }
+        }
+        const double* values = integrand.runBatch(registers, count);
+
+        // Values after the last whole round go to the first lanes
+        int wholeCount = count / simdLanes * simdLanes;
+        for (int j = 0; j < wholeCount; j += simdLanes)
+        {
+#pragma omp simd aligned(laneSums, laneSquares : 64)
+            for (int lane = 0; lane < simdLanes; ++lane)
+            {
+                laneSums[lane] += values[j + lane];
+                laneSquares[lane] += values[j + lane] * values[j + lane];
+            }
+        }
+        for (int j = wholeCount; j < count; ++j)
+        {
+            laneSums[j - wholeCount] += values[j];
+            laneSquares[j - wholeCount] += values[j] * values[j];
+        }
+        index += count;
+    }
+
+    QmcBlockSums sums = { sumPairwise(laneSums, simdLanes), sumPairwise(laneSquares, simdLanes) };
+    return sums;
+}
+
+/*
+* Function to integrate over a cube with scrambled Sobol points
+* Block b of replicate r is item r * blockCount + b of one parallel loop
+* @param integrand compiled expression of x1 to x<dimension>
+* @param dimension number of variables of the integral, 1 to maxSobolDimension
+* @param lowerBound lower bound of every variable
+* @param upperBound upper bound of every variable
+* @param points points of every replicate, at most 2^32
+* @param replicates number of independent scrambles, at least 2 for an error estimate
+* @param seed seed of the scrambles
+* Return integral, its error estimate and the error plain Monte Carlo would have
+*/
+QmcResult integrateQuasiMonteCarlo(const ExpressionProgram& integrand, int dimension, double lowerBound,
+    double upperBound, long long points, int replicates, std::uint64_t seed)
+{
+    // Scrambles drawn one after the other from the seed
+    std::mt19937_64 random(seed);
+    std::vector<SobolSequence> sequences;
+    for (int r = 0; r < replicates; ++r)
+    {
+        sequences.push_back(SobolSequence(dimension));
+        sequences.back().scramble(random);
+    }
+
+    double width = upperBound - lowerBound;
+    long long blockCount = (points + qmcBlockPoints - 1) / qmcBlockPoints;
+    long long itemCount = blockCount * replicates;
+    std::vector<double> blockSums(itemCount);
+    std::vector<double> blockSquares(itemCount);
+
+#pragma omp parallel for schedule(static)
+    for (long long item = 0; item < itemCount; ++item)
+    {
+        long long firstIndex = item % blockCount * qmcBlockPoints;
+        QmcBlockSums sums = sumSobolPoints(integrand, sequences[item / blockCount], lowerBound, width, firstIndex,
+            std::min(qmcBlockPoints, points - firstIndex));
+        blockSums[item] = sums.sum;
+        blockSquares[item] = sums.squares;
+    }
+
+    double volume = pow(width, dimension);
+    std::vector<double> replicateMeans(replicates);
+    for (int r = 0; r < replicates; ++r)
+    {
+        replicateMeans[r] = sumPairwise(blockSums.data() + r * blockCount, blockCount) / points * volume;
+    }
+    double totalCount = (double)points * replicates;
+    double mean = sumPairwise(replicateMeans.data(), replicates) / replicates;
+
+    double spread = 0;
+    for (int r = 0; r < replicates; ++r)
+    {
+        spread += (replicateMeans[r] - mean) * (replicateMeans[r] - mean);
+    }
+    // Variance of the integrand over the cube, from all the points
+    double pointMean = sumPairwise(blockSums.data(), itemCount) / totalCount;
+    double pointVariance = std::max(0.0, sumPairwise(blockSquares.data(), itemCount) / totalCount -
+        pointMean * pointMean);
+
+    QmcResult result;
+    result.integral = mean;
+    result.standardError = replicates > 1 ? sqrt(spread / (replicates - 1) / replicates) : INFINITY;
+    result.monteCarloError = sqrt(pointVariance / totalCount) * fabs(volume);
+    result.evaluations = (long long)totalCount;
+    return result;
+}
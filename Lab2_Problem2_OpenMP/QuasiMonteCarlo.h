@@ -0,0 +1,51 @@
+/*
+* Header file for the quasi Monte Carlo integration
+*
+* The integral over the cube [lowerBound, upperBound]^dimension is the mean
+* of the integrand at the points of a scrambled Sobol sequence times the
+* volume. Every replicate has its own random scramble, the replicates are
+* independent unbiased estimates: their mean is the integral and their
+* spread its standard error. The points of all the replicates are cut into
+* blocks of a fixed number of points, the blocks are shared out over the
+* threads and every block jumps to its first point (see SobolSequence.h),
+* the block sums are added in a fixed pairwise tree so the result does not
+* depend on the number of threads.
+*/
+
+#ifndef __QUASIMONTECARLO__HEADER__
+#define __QUASIMONTECARLO__HEADER__
+
+#include <cstdint>
+
+#include "ExpressionProgram.h"
+#include "SobolSequence.h"
+
+// Points of a block, a multiple of expressionBatch
+const long long qmcBlockPoints = 16384;
+
+/*
+* Struct to hold the result of a quasi Monte Carlo integration
+*/
+struct QmcResult
+{
+    double integral;                // mean of the replicates
+    double standardError;           // standard error of the mean of the replicates
+    double monteCarloError;         // standard error of plain Monte Carlo with the same number of evaluations
+    long long evaluations;          // number of times the integrand was evaluated
+};
+
+/*
+* Function to integrate over a cube with scrambled Sobol points
+* @param integrand compiled expression of x1 to x<dimension>
+* @param dimension number of variables of the integral, 1 to maxSobolDimension
+* @param lowerBound lower bound of every variable
+* @param upperBound upper bound of every variable
+* @param points points of every replicate, at most 2^32
+* @param replicates number of independent scrambles, at least 2 for an error estimate
+* @param seed seed of the scrambles
+* Return integral, its error estimate and the error plain Monte Carlo would have
+*/
+QmcResult integrateQuasiMonteCarlo(const ExpressionProgram& integrand, int dimension, double lowerBound,
+    double upperBound, long long points, int replicates, std::uint64_t seed);
+
+#endif // !__QUASIMONTECARLO__HEADER__
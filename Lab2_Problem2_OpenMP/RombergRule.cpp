@@ -0,0 +1,59 @@
+/*
+* Implementation file for RombergRule.cpp
+*/
+
+#include "RombergRule.h"
+
+#include <cmath>
+
+#include "MidpointRule.h"
+
+/*
+* Function to integrate an expression with the Romberg method
+* Only the last row of the Romberg table is kept, row k is built from row k - 1
+* @param integrand compiled expression to integrate
+* @param lowerBound lower bound of the integral
+* @param upperBound upper bound of the integral
+* @param tolerance absolute error to stop at
+* Return integral, its error estimate and the work done
+*/
+RombergResult integrateRomberg(const ExpressionProgram& integrand, double lowerBound, double upperBound,
+    double tolerance)
+{
+    double previousRow[maxRombergLevels];
+    double row[maxRombergLevels];
+
+    // Level 0, the trapezoid on the 2 bounds
+    double width = upperBound - lowerBound;
+    double trapezoid = width / 2 * (integrand.evaluate(lowerBound) + integrand.evaluate(upperBound));
+    previousRow[0] = trapezoid;
+
+    RombergResult result = { trapezoid, INFINITY, 1, 2, false };
+    for (int level = 1; level < maxRombergLevels && not result.converged; ++level)
+    {
+        // The midpoints of the 2^(level - 1) steps of the level before are the new points
+        long long midpointCount = 1LL << (level - 1);
+        double midpoints = integrateExpressionMidpoint(integrand, lowerBound, upperBound, midpointCount);
+        trapezoid = (trapezoid + midpoints) / 2;
+        result.evaluations += midpointCount;
+
+        // Richardson extrapolation, the error of column j goes down by 4^(j + 1) per level
+        row[0] = trapezoid;
+        double factor = 1;
+        for (int column = 1; column <= level; ++column)
+        {
+            factor *= 4;
+            row[column] = row[column - 1] + (row[column - 1] - previousRow[column - 1]) / (factor - 1);
+        }
+
+        result.errorEstimate = fabs(row[level] - previousRow[level - 1]);
+        result.integral = row[level];
+        result.levels = level + 1;
+        result.converged = level + 1 >= minRombergLevels && result.errorEstimate <= tolerance;
+        for (int column = 0; column <= level; ++column)
+        {
+            previousRow[column] = row[column];
+        }
+    }
+    return result;
+}
@@ -0,0 +1,46 @@
+/*
+* Header file for the Romberg integration
+*
+* Level k of the trapezoid rule has 2^k steps. Its points are the points of
+* level k - 1 and the midpoints of the steps of level k - 1, so
+* T(k) = (T(k - 1) + M(k - 1)) / 2 with M the midpoint rule. Only the new
+* midpoints are evaluated, with the parallel midpoint rule of
+* MidpointRule.h. Every level is Richardson extrapolated with the levels
+* before it, the difference between the last two diagonal values is the
+* error estimate and the levels stop once it is below the tolerance.
+*/
+
+#ifndef __ROMBERGRULE__HEADER__
+#define __ROMBERGRULE__HEADER__
+
+#include "ExpressionProgram.h"
+
+// Max number of levels, the last one evaluates 2^(maxRombergLevels - 1) midpoints
+const int maxRombergLevels = 30;
+// Min number of levels before the error estimate is trusted
+const int minRombergLevels = 3;
+
+/*
+* Struct to hold the result of a Romberg integration
+*/
+struct RombergResult
+{
+    double integral;        // last diagonal value of the Romberg table
+    double errorEstimate;   // difference to the diagonal value of the level before
+    int levels;             // number of trapezoid levels used
+    long long evaluations;  // number of times the integrand was evaluated
+    bool converged;         // whether the error estimate got below the tolerance
+};
+
+/*
+* Function to integrate an expression with the Romberg method
+* @param integrand compiled expression to integrate
+* @param lowerBound lower bound of the integral
+* @param upperBound upper bound of the integral
+* @param tolerance absolute error to stop at
+* Return integral, its error estimate and the work done
+*/
+RombergResult integrateRomberg(const ExpressionProgram& integrand, double lowerBound, double upperBound,
+    double tolerance);
+
+#endif // !__ROMBERGRULE__HEADER__
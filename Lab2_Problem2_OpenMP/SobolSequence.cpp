@@ -0,0 +1,144 @@
+/*
+* Implementation file for SobolSequence.cpp
+*/
+
+#include "SobolSequence.h"
+
+/*
+* Struct to hold the primitive polynomial and the first direction numbers of a dimension
+*/
+struct SobolPolynomial
+{
+    int degree;             // s, degree of the polynomial
+    int coefficients;       // a, inner coefficients of the polynomial
+    int initial[7];         // m_1 to m_s, odd and below 2^k
+};
+
+// Joe and Kuo, dimensions 2 to 20, dimension 1 is the van der Corput sequence
+static const SobolPolynomial sobolPolynomials[maxSobolDimension - 1] = {
+    { 1, 0, { 1 } },
+    { 2, 1, { 1, 3 } },
+    { 3, 1, { 1, 3, 1 } },
+    { 3, 2, { 1, 1, 1 } },
+    { 4, 1, { 1, 1, 3, 3 } },
+    { 4, 4, { 1, 3, 5, 13 } },
+    { 5, 2, { 1, 1, 5, 5, 17 } },
+    { 5, 4, { 1, 1, 5, 5, 5 } },
+    { 5, 7, { 1, 1, 7, 11, 19 } },
+    { 5, 11, { 1, 1, 5, 1, 1 } },
+    { 5, 13, { 1, 1, 1, 3, 11 } },
+    { 5, 14, { 1, 3, 5, 5, 31 } },
+    { 6, 1, { 1, 3, 3, 9, 7, 49 } },
+    { 6, 13, { 1, 1, 1, 15, 21, 21 } },
+    { 6, 16, { 1, 3, 1, 13, 27, 49 } },
+    { 6, 19, { 1, 1, 1, 15, 7, 5 } },
+    { 6, 22, { 1, 3, 1, 15, 13, 25 } },
+    { 6, 25, { 1, 1, 5, 5, 19, 61 } },
+    { 7, 1, { 1, 3, 7, 11, 23, 15, 103 } } };
+
+/*
+* Function to get the parity of the set bits
+*/
+static inline std::uint32_t parity(std::uint32_t value)
+{
+#if defined(__GNUC__)
+    return (std::uint32_t)__builtin_parity(value);
+#else
+    value ^= value >> 16;
+    value ^= value >> 8;
+    value ^= value >> 4;
+    value ^= value >> 2;
+    value ^= value >> 1;
+    return value & 1;
+#endif
+}
+
+/*
+* Constructor to create the sequence without scramble
+* @param dimension number of coordinates of a point, 1 to maxSobolDimension
+*/
+SobolSequence::SobolSequence(int dimension) : dimension(dimension)
+{
+    for (int k = 0; k < sobolBits; ++k)
+    {
+        this->directions[0][k] = 1u << (sobolBits - 1 - k);
+    }
+    for (int d = 1; d < maxSobolDimension; ++d)
+    {
+        const SobolPolynomial& polynomial = sobolPolynomials[d - 1];
+        int s = polynomial.degree;
+        std::uint32_t* v = this->directions[d];
+        for (int k = 0; k < s; ++k)
+        {
+            v[k] = (std::uint32_t)polynomial.initial[k] << (sobolBits - 1 - k);
+        }
+        // m_k = 2 a_1 m_(k-1) ^ 4 a_2 m_(k-2) ^ ... ^ 2^s m_(k-s) ^ m_(k-s), as shifts of the direction numbers
+        for (int k = s; k < sobolBits; ++k)
+        {
+            v[k] = v[k - s] ^ (v[k - s] >> s);
+            for (int i = 1; i < s; ++i)
+            {
+                if ((polynomial.coefficients >> (s - 1 - i)) & 1)
+                {
+                    v[k] ^= v[k - i];
+                }
+            }
+        }
+    }
+    for (int d = 0; d < maxSobolDimension; ++d)
+    {
+        this->shifts[d] = 0;
+    }
+}
+
+/*
+* Function to scramble the sequence with a random linear matrix scramble and digital shift
+* Digit r of a scrambled direction number is the parity of row r of the matrix and the digits 0 to r
+* @param random generator to draw the scramble from
+*/
+void SobolSequence::scramble(std::mt19937_64& random)
+{
+    for (int d = 0; d < this->dimension; ++d)
+    {
+        // Row r has a 1 on the diagonal, random bits to its left, bit 31 - c is column c
+        std::uint32_t rows[sobolBits];
+        for (int r = 0; r < sobolBits; ++r)
+        {
+            std::uint32_t diagonal = 1u << (sobolBits - 1 - r);
+            std::uint32_t left = r == 0 ? 0 : ~((diagonal << 1) - 1);
+            rows[r] = diagonal | ((std::uint32_t)random() & left);
+        }
+        for (int k = 0; k < sobolBits; ++k)
+        {
+            std::uint32_t scrambled = 0;
+            for (int r = 0; r < sobolBits; ++r)
+            {
+                scrambled |= parity(rows[r] & this->directions[d][k]) << (sobolBits - 1 - r);
+            }
+            this->directions[d][k] = scrambled;
+        }
+        this->shifts[d] = (std::uint32_t)random();
+    }
+}
+
+/*
+* Function to jump to a point
+* @param index index of the point, below 2^sobolBits
+* @param point reference to set the coordinates of the point, dimension values
+*/
+void SobolSequence::getPoint(std::uint64_t index, std::uint32_t* point) const
+{
+    std::uint64_t gray = index ^ (index >> 1);
+    for (int d = 0; d < this->dimension; ++d)
+    {
+        std::uint32_t value = this->shifts[d];
+        for (int bit = 0; bit < sobolBits; ++bit)
+        {
+            if ((gray >> bit) & 1)
+            {
+                value ^= this->directions[d][bit];
+            }
+        }
+        point[d] = value;
+    }
+}
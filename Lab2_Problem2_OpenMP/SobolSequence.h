@@ -0,0 +1,97 @@
+/*
+* Header file for the scrambled Sobol sequence
+*
+* The direction numbers of the first maxSobolDimension dimensions are the
+* ones of Joe and Kuo (new-joe-kuo-6.21201). The points are in Gray code
+* order, so point n is the xor of the direction numbers of the set bits of
+* n ^ (n >> 1) and point n + 1 is point n xor one direction number: any
+* thread can jump to its first point and go on from there with no state
+* shared with the other threads.
+*
+* A sequence is randomized by a linear matrix scramble (a random lower
+* triangular binary matrix times every direction number) followed by a
+* digital shift (a random xor). The points of every scramble are still a
+* (t, s)-sequence and independent scrambles give independent unbiased
+* estimates, whose spread is the error estimate.
+*/
+
+#ifndef __SOBOLSEQUENCE__HEADER__
+#define __SOBOLSEQUENCE__HEADER__
+
+#include <cstdint>
+#include <random>
+
+// Dimensions with direction numbers
+const int maxSobolDimension = 20;
+// Bits of a coordinate, at most 2^sobolBits points
+const int sobolBits = 32;
+
+/*
+* Class for the direction numbers and the scramble of a Sobol sequence
+*/
+class SobolSequence
+{
+    // Direction numbers, bit 31 is the first binary digit of the coordinate
+    std::uint32_t directions[maxSobolDimension][sobolBits];
+    std::uint32_t shifts[maxSobolDimension];
+    int dimension;
+
+public:
+    /*
+    * Constructor to create the sequence without scramble
+    * @param dimension number of coordinates of a point, 1 to maxSobolDimension
+    */
+    explicit SobolSequence(int dimension);
+
+    /*
+    * Function to scramble the sequence with a random linear matrix scramble and digital shift
+    * @param random generator to draw the scramble from
+    */
+    void scramble(std::mt19937_64& random);
+
+    /*
+    * Function to jump to a point
+    * @param index index of the point, below 2^sobolBits
+    * @param point reference to set the coordinates of the point, dimension values
+    */
+    void getPoint(std::uint64_t index, std::uint32_t* point) const;
+
+    /*
+    * Function to go from a point to the next one
+    * @param index index of the point, below 2^sobolBits - 1 as the last point has no next one
+    * @param point coordinates of the point, changed to the ones of point index + 1
+    */
+    void nextPoint(std::uint64_t index, std::uint32_t* point) const
+    {
+        // The Gray codes of index and index + 1 differ by the lowest zero bit of index
+        int bit = 0;
+        while ((index >> bit) & 1)
+        {
+            ++bit;
+        }
+        for (int d = 0; d < this->dimension; ++d)
+        {
+            point[d] ^= this->directions[d][bit];
+        }
+    }
+
+    /*
+    * Function to get a coordinate in (0, 1)
+    * @param value coordinate of a point
+    * Return the coordinate moved to the middle of its 2^-sobolBits cell, never 0 or 1
+    */
+    static double toUnit(std::uint32_t value)
+    {
+        return ((double)value + 0.5) * (1.0 / 4294967296.0);
+    }
+
+    /*
+    * Getter for the number of coordinates of a point
+    */
+    int getDimension() const
+    {
+        return this->dimension;
+    }
+};
+
+#endif // !__SOBOLSEQUENCE__HEADER__
@@ -0,0 +1,297 @@
+/*
+Description:
+    Solution file for Lab 6.
+    Runs the ant and seeds Monte Carlo of Lab 2 Problem 1 over MPI ranks, every rank with its own threads
+
+    Run i uses the random stream of (seed, i) (see RandomGenerators.h), so every rank does a contiguous range of
+    the run indexes and the streams of the ranks never overlap. Rank 0 picks the seed and sends it to the others,
+    the sums and histograms of the steps are added up on rank 0 with MPI_Reduce. The result of a seed is the same
+    for any number of ranks and threads, and the same as Lab 2 Problem 1 with that seed.
+
+    Usage:
+        mpirun -np <ranks> ./sim [--runs <n>] [--grid <w> <h>] [--threads <n>] [--pin <none|cores|nodes>]
+                                 [--batch <n>] [--seed <n>]
+        --runs <n>      total number of runs of all the ranks (default 10000000)
+        --grid <w> <h>  grid size, one of the sizes compiled in findGridKernel (default 5 x 5)
+        --threads <n>   threads per rank (default the cpus the rank may run on)
+        --pin <mode>    pins the threads of a rank to its cpus or NUMA nodes (see ThreadPlacement.h)
+        --batch <n>     runs per chunk of the work stealing scheduler (default 10000)
+        --seed <n>      seed of the simulation (default from std::random_device on rank 0)
+*/
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AntLanes.h"
+#include "AntWalker.h"
+#include "RunStatistics.h"
+#include "StepHistogram.h"
+#include "ThreadPlacement.h"
+#include "WorkScheduler.h"
+
+/*
+* Struct to hold the totals of a thread, alone on its cache lines
+*/
+struct alignas(cacheLineSize) RankThreadTotals
+{
+    AntRunTotals totals;
+    StepHistogram histogram;
+
+    RankThreadTotals()
+    {
+        this->totals.runs = 0;
+        this->totals.steps = 0;
+        this->totals.squaredSteps = 0;
+    }
+};
+
+/*
+* Function to run the chunks of the runs of this rank given by the scheduler
+*
+* @param kernel kernel of the grid to walk
+* @param scheduler scheduler handing out the chunks of the runs of this rank
+* @param thread index of this thread in the scheduler
+* @param seed seed of the simulation
+* @param rankFirstRun index of the first run of this rank, the scheduler counts from 0
+* @param placement cpu topology to pin the thread with
+* @param pinning way to pin the thread
+* @param threadTotals totals of this thread, added up after the join
+*/
+void antTravelRank(const AntGridKernel* kernel, WorkStealingScheduler& scheduler, const unsigned int thread,
+    const std::uint64_t seed, const unsigned long long rankFirstRun, const ThreadPlacement& placement,
+    const threadPinning pinning, RankThreadTotals& threadTotals)
+{
+    placement.pinThread(thread, pinning);
+    // Totals are filled on the stack of the pinned thread and copied out once
+    RankThreadTotals localTotals;
+
+    unsigned long long firstRun = 0;
+    unsigned long chunkRuns = 0;
+    while (scheduler.nextChunk(thread, firstRun, chunkRuns))
+    {
+        addRunTotals(localTotals.totals,
+            kernel->walkRuns(seed, rankFirstRun + firstRun, chunkRuns, localTotals.histogram));
+    }
+    threadTotals = localTotals;
+}
+
+/*
+* Function to check whether the input argument is a number,
+* if so, then set the number through reference
+* else, return false
+*
+* @param charsToCheck char array to verify
+* @param inNumber reference to original variable to set
+* Returns: bool if input is a number
+*/
+bool convertToNumber(const char* charsToCheck, unsigned long long& inNumber)
+{
+    // check to see if the char array is a positive integer
+    try
+    {
+        bool check = strlen(charsToCheck) > 0 && std::all_of(charsToCheck, charsToCheck + strlen(charsToCheck),
+            [](char c) { return ::isdigit(c); });
+        if (check)
+        {
+            inNumber = std::stoull(std::string(charsToCheck));
+            return true;
+        }
+        return false;
+    }
+    catch (const std::exception&)
+    {
+        // return invalid if exception occured
+        return false;
+    }
+}
+
+/*
+* Function to write the result of all the ranks
+*
+* @param ofOutFile stream to write to
+* @param rankCount number of ranks
+* @param threadCount number of threads of rank 0
+* @param kernel kernel of the grid
+* @param seed seed of the simulation
+* @param totals totals of all the runs
+* @param histogram histogram of the steps of all the runs
+* @param seconds wall time of the slowest rank
+*/
+void writeResult(std::ofstream& ofOutFile, int rankCount, unsigned int threadCount, const AntGridKernel* kernel,
+    unsigned long long seed, const AntRunTotals& totals, const StepHistogram& histogram, double seconds)
+{
+    RunStatistics statistics = RunStatistics::fromSums((double)totals.runs, (double)totals.steps,
+        (double)totals.squaredSteps);
+
+    ofOutFile << "Number of ranks: " << rankCount << ", threads per rank: " << threadCount << "\n\n";
+    ofOutFile << "Grid: " << kernel->width << " x " << kernel->height << "\n\n";
+    ofOutFile << "Seed: " << seed << "\n\n";
+    ofOutFile << std::fixed << std::setprecision(6) << "Expected number of steps: " << statistics.mean << "\n\n";
+    ofOutFile << "Standard error of the mean: " << statistics.standardError()
+        << " (95% confidence half width: " << statistics.halfWidth() << ")\n\n";
+    ofOutFile << "Total number of runs: " << totals.runs << "\n\n";
+    ofOutFile << std::setprecision(3) << "Run time: " << seconds << " s, " << std::setprecision(0)
+        << totals.runs / seconds << " runs per second\n\n";
+    ofOutFile << "Steps quantiles (upper bound of the bucket): p50 " << histogram.getQuantile(0.5)
+        << ", p90 " << histogram.getQuantile(0.9) << ", p99 " << histogram.getQuantile(0.99)
+        << ", p99.9 " << histogram.getQuantile(0.999);
+}
+
+int main(int argc, char* argv[])
+{
+    MPI_Init(&argc, &argv);
+    int rank = 0, rankCount = 1;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &rankCount);
+
+    unsigned long long totalRuns = 10000000;
+    unsigned long long gridWidth = gridSize, gridHeight = gridSize;
+    unsigned long long threadCount = 0;
+    unsigned long long batchRuns = 10000;
+    unsigned long long seed = 0;
+    bool seedGiven = false;
+    threadPinning pinning = pinNone;
+    bool validArgs = true;
+    for (int i = 1; i < argc && validArgs; ++i)
+    {
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+        {
+            validArgs = convertToNumber(argv[++i], totalRuns) && totalRuns > 0;
+        }
+        else if (strcmp(argv[i], "--grid") == 0 && i + 2 < argc)
+        {
+            validArgs = convertToNumber(argv[i + 1], gridWidth) && convertToNumber(argv[i + 2], gridHeight) &&
+                gridWidth <= 1000 && gridHeight <= 1000;
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            validArgs = convertToNumber(argv[++i], threadCount) && threadCount >= 1 && threadCount <= 4096;
+        }
+        else if (strcmp(argv[i], "--pin") == 0 && i + 1 < argc)
+        {
+            validArgs = ThreadPlacement::findPinning(argv[++i], pinning);
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+        {
+            validArgs = convertToNumber(argv[++i], batchRuns) && batchRuns > 0 && batchRuns <= 1000000000;
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            validArgs = convertToNumber(argv[++i], seed);
+            seedGiven = true;
+        }
+        else
+        {
+            validArgs = false;
+        }
+    }
+    const AntGridKernel* kernel = validArgs ? findGridKernel((int)gridWidth, (int)gridHeight) : NULL;
+    // Chunks of a rank are counted in 32 bits by the scheduler
+    validArgs = kernel != NULL && totalRuns / batchRuns < 0xFFFFFFFFULL;
+
+    if (not validArgs)
+    {
+        if (rank == 0)
+        {
+            std::ofstream ofOutFile("Lab6.txt", std::ios::trunc);
+            ofOutFile << "Invalid inputs";
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Rank 0 picks the seed, every rank needs the same one
+    if (rank == 0 && not seedGiven)
+    {
+        std::random_device rd;
+        seed = ((unsigned long long)rd() << 32) | rd();
+    }
+    MPI_Bcast(&seed, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+
+    // Contiguous range of the run indexes of this rank
+    unsigned long long rankFirstRun = totalRuns * rank / rankCount;
+    unsigned long long rankRuns = totalRuns * (rank + 1) / rankCount - rankFirstRun;
+
+    ThreadPlacement placement;
+    unsigned int numThreads = threadCount > 0 ? (unsigned int)threadCount : placement.getCpuCount();
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double startTime = MPI_Wtime();
+
+    AntRunTotals rankTotals = { 0, 0, 0 };
+    StepHistogram rankHistogram;
+    if (rankRuns > 0)
+    {
+        WorkStealingScheduler scheduler(rankRuns, (unsigned long)batchRuns, numThreads);
+        CacheAlignedArray<RankThreadTotals> threadTotals(numThreads);
+        std::vector<std::thread> threadVector;
+        threadVector.reserve(numThreads);
+        for (unsigned int i = 0; i < numThreads; ++i)
+        {
+            threadVector.push_back(std::thread(antTravelRank, kernel, std::ref(scheduler), i, (std::uint64_t)seed,
+                rankFirstRun, std::cref(placement), pinning, std::ref(threadTotals[i])));
+        }
+        for (unsigned int i = 0; i < numThreads; ++i)
+        {
+            threadVector[i].join();
+            addRunTotals(rankTotals, threadTotals[i].totals);
+            rankHistogram.add(threadTotals[i].histogram);
+        }
+    }
+    double rankSeconds = MPI_Wtime() - startTime;
+
+    // Sums and histograms of all the ranks to rank 0, the counts are integers so the order does not matter
+    unsigned long long rankSums[3] = { rankTotals.runs, rankTotals.steps, rankTotals.squaredSteps };
+    unsigned long long totalSums[3] = { 0, 0, 0 };
+    MPI_Reduce(rankSums, totalSums, 3, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    std::vector<unsigned long long> rankCounts(histogramSize);
+    std::vector<unsigned long long> totalCounts(histogramSize, 0);
+    for (int bucket = 0; bucket < histogramSize; ++bucket)
+    {
+        rankCounts[bucket] = rankHistogram.getCount(bucket);
+    }
+    MPI_Reduce(rankCounts.data(), totalCounts.data(), histogramSize, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0,
+        MPI_COMM_WORLD);
+
+    double maxSeconds = 0;
+    MPI_Reduce(&rankSeconds, &maxSeconds, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    int exitCode = 0;
+    if (rank == 0)
+    {
+        AntRunTotals totals = { (unsigned long)totalSums[0], totalSums[1], totalSums[2] };
+        StepHistogram histogram;
+        for (int bucket = 0; bucket < histogramSize; ++bucket)
+        {
+            histogram.addCount(bucket, totalCounts[bucket]);
+        }
+
+        std::ofstream ofOutFile;
+        ofOutFile.open("Lab6.txt", std::ios::trunc);
+        if (not ofOutFile.is_open())
+        {
+            // If unable to open output file => print error
+            std::cerr << "Unable to open output file: Lab6.txt" << std::endl;
+            exitCode = 1;
+        }
+        else
+        {
+            writeResult(ofOutFile, rankCount, numThreads, kernel, seed, totals, histogram, maxSeconds);
+            ofOutFile.close();
+        }
+    }
+
+    MPI_Finalize();
+    return exitCode;
+}